@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../include/common.h"
+
+NAMESPACE_BEGIN
+
+/**
+ * @brief A small benchmark runner. Benchmarks register themselves like test suites do:
+ *
+ * @code
+ * static bench::Benchmark _("keywords/perfect hash", [](std::uint64_t iterations) {
+ *     std::uint64_t sum = 0;
+ *     for (std::uint64_t i = 0; i < iterations; ++i) { sum += work(i); }
+ *     return sum;
+ * });
+ * @endcode
+ *
+ * A body runs its work iterations times and returns a checksum of the results, so the work can't be
+ * optimized away. The runner doubles the iterations until a run takes long enough to time.
+ *
+ * Benchmarks over an input, like a tokenizer over a generated program, also say how many bytes and
+ * tokens one iteration goes through, the results then have MB/s, tokens/s and ns/token too.
+ */
+namespace bench {
+
+using Body = std::function<std::uint64_t(std::uint64_t iterations)>;
+
+// What one iteration of a benchmark goes through
+struct Throughput {
+    std::uint64_t bytes = 0;
+    std::uint64_t tokens = 0;
+};
+
+using Prepare = std::function<Throughput()>;
+
+struct Benchmark {
+    Benchmark(std::string name, Body body);
+
+    // A benchmark over an input of about input_size bytes. prepare runs before body is timed, e.g. to
+    // build the input, and tells what one iteration goes through.
+    Benchmark(std::string name, std::uint64_t input_size, Prepare prepare, Body body);
+};
+
+struct Result {
+    std::string name;
+    std::uint64_t iterations = 0;
+    std::chrono::nanoseconds time{};
+    std::uint64_t checksum = 0;
+
+    // zero for a benchmark without an input
+    Throughput throughput;
+
+    // the most memory the process had resident while the benchmark ran, 0 if it can't be measured
+    std::uint64_t peak_rss = 0;
+
+    [[nodiscard]] double seconds() const { return std::chrono::duration<double>(time).count(); }
+
+    [[nodiscard]] double nsPerIteration() const {
+        return static_cast<double>(time.count()) / static_cast<double>(iterations);
+    }
+
+    [[nodiscard]] double megabytesPerSecond() const {
+        return static_cast<double>(throughput.bytes * iterations) / 1e6 / seconds();
+    }
+
+    [[nodiscard]] double tokensPerSecond() const {
+        return static_cast<double>(throughput.tokens * iterations) / seconds();
+    }
+
+    [[nodiscard]] double nsPerToken() const {
+        return throughput.tokens == 0 ? 0 : nsPerIteration() / static_cast<double>(throughput.tokens);
+    }
+};
+
+struct Options {
+    // only benchmarks whose name contains filter run
+    std::string_view filter;
+
+    // benchmarks over a larger input are skipped, the generated corpora go up to 1 GB
+    std::uint64_t max_input = 16 << 20;
+
+    // print JSON instead of a table
+    bool json = false;
+};
+
+// Runs the benchmarks options selects, in registration order
+std::vector<Result> run(const Options &options = {});
+
+// results as a JSON object, one entry per benchmark in "benchmarks"
+std::string toJson(std::span<const Result> results);
+
+// Entry point of rara-bench, args are the command line without the program name
+int main(std::span<const std::string_view> args);
+
+}  // namespace bench
+
+NAMESPACE_END
@@ -0,0 +1,237 @@
+#include "corpus.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+
+using namespace NAMESPACE;
+
+namespace {
+
+constexpr std::array<std::string_view, 16> words = {"value", "count", "total", "index", "name",  "result",
+                                                    "other", "first", "last",  "size",  "token", "state",
+                                                    "left",  "right", "depth", "node"};
+
+constexpr std::array<std::string_view, 4> types = {"int", "float", "string", "bool"};
+
+/**
+ * @brief Writes the units of a program, one declaration, function, comment or literal at a time.
+ *        Every unit ends with a newline, so cutting the program after one leaves it whole. Random
+ *        picks are made one statement at a time, the order function arguments are evaluated in
+ *        differs between compilers and the program has to be the same with all of them.
+ */
+class Generator {
+public:
+    explicit Generator(std::uint64_t seed) : _state(seed) {}
+
+    // A number in [0, bound)
+    std::uint64_t below(std::uint64_t bound) { return next() % bound; }
+
+    void declaration(std::string &out) {
+        const auto a = name();
+        const auto b = name();
+        const auto t = type();
+        const auto number = below(1000);
+
+        switch (below(7)) {
+            case 0:
+                out += std::format("{} :: {}\n", a, number);
+                break;
+            case 1:
+                out += std::format("{} : {} : {}\n", a, t, number);
+                break;
+            case 2:
+                out += std::format("{} :mutable {}: {}\n", a, t, number % 100);
+                break;
+            case 3:
+                out += std::format("{} :mutable {}: ?\n", a, t);
+                break;
+            case 4:
+                out += std::format("{} as {}\n", a, number % 10);
+                break;
+            case 5:
+                out += std::format("{} = {}!\n", a, number % 100);
+                break;
+            default:
+                out += std::format("{} = {}!\n", a, b);
+                break;
+        }
+    }
+
+    void function(std::string &out, bool documented) {
+        const auto f = name();
+        const auto result = type();
+        const auto a = name();
+        const auto a_type = type();
+        const auto b = name();
+        const auto b_type = type();
+
+        switch (below(3)) {
+            case 0:
+                out += std::format("{} : {} : ({}: {}, {}: {})\n", f, result, a, a_type, b, b_type);
+                break;
+            case 1:
+                out += std::format("{} :: ({}: {}, {}: {})\n", f, a, a_type, b, b_type);
+                break;
+            default:
+                out += std::format("{} as ({}: {})\n", f, a, a_type);
+                break;
+        }
+
+        if (documented) {
+            const auto line = below(2) == 0;
+            const auto doc = sentence(4 + below(12));
+            out += line ? std::format("    -- {}\n", doc) : std::format("    !-\n    {}\n    -!\n", doc);
+        }
+
+        for (auto lines = 1 + below(6); lines > 0; --lines) {
+            out += "    ";
+            declaration(out);
+        }
+
+        const auto returned = name();
+        out += below(3) == 0 ? "    return\n\n" : std::format("    return {}\n\n", returned);
+    }
+
+    void comment(std::string &out) {
+        if (below(4) == 0) {
+            const auto first = sentence(8 + below(24));
+            const auto second = sentence(8 + below(24));
+            out += std::format("!-\n{}\n{}\n-!\n", first, second);
+        } else {
+            out += std::format("-- {}\n", sentence(3 + below(12)));
+        }
+    }
+
+    // long_limit is the longest a long string literal can be
+    void literal(std::string &out, std::size_t long_limit) {
+        const auto a = name();
+        switch (below(5)) {
+            case 0: {
+                const auto shift = below(64);
+                out += std::format("{} :: {}\n", a, next() >> shift);
+                break;
+            }
+            case 1: {
+                const auto whole = below(100000);
+                out += std::format("{} : float : {}.{}\n", a, whole, below(1000000));
+                break;
+            }
+            case 2:
+            case 3:
+                out += std::format("{} :: \"{}\"\n", a, sentence(1 + below(12)));
+                break;
+            default: {
+                auto length = std::min<std::size_t>(256 + below(4096), long_limit);
+                std::string text;
+                while (text.size() < length) {
+                    text += words[below(words.size())];
+                    text += below(8) == 0 ? "\\n" : " ";
+                }
+                out += std::format("{} :: \"{}\"\n", a, text);
+                break;
+            }
+        }
+    }
+
+private:
+    // splitmix64
+    std::uint64_t next() {
+        auto z = (_state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // a few hundred distinct names, used over and over like in a real program
+    std::string name() {
+        const auto word = words[below(words.size())];
+        return std::format("{}_{}", word, below(32));
+    }
+
+    std::string_view type() { return types[below(types.size())]; }
+
+    std::string sentence(std::uint64_t count) {
+        std::string text;
+        for (std::uint64_t i = 0; i < count; ++i) {
+            if (i > 0) {
+                text += ' ';
+            }
+            text += words[below(words.size())];
+        }
+        return text;
+    }
+
+    std::uint64_t _state;
+};
+
+}  // namespace
+
+std::string_view bench::shapeName(Shape shape) {
+    switch (shape) {
+        case Shape::mixed:
+            return "mixed";
+        case Shape::comments:
+            return "comments";
+        case Shape::literals:
+            return "literals";
+    }
+    return "unknown";
+}
+
+std::string bench::generateCorpus(Shape shape, std::size_t size, std::uint64_t seed) {
+    Generator generator(seed);
+
+    std::string out;
+    out.reserve(size);
+
+    // units that didn't fit in a row, the program is as full as it gets
+    std::size_t misses = 0;
+
+    std::string unit;
+    while (misses < 16) {
+        unit.clear();
+
+        // percentages of declarations, functions and comments, the rest are literals
+        auto pick = generator.below(100);
+        switch (shape) {
+            case Shape::mixed:
+                if (pick < 45) {
+                    generator.declaration(unit);
+                } else if (pick < 85) {
+                    generator.function(unit, pick < 55);
+                } else {
+                    generator.comment(unit);
+                }
+                break;
+            case Shape::comments:
+                if (pick < 20) {
+                    generator.declaration(unit);
+                } else if (pick < 40) {
+                    generator.function(unit, true);
+                } else {
+                    generator.comment(unit);
+                }
+                break;
+            case Shape::literals:
+                if (pick < 15) {
+                    generator.declaration(unit);
+                } else if (pick < 30) {
+                    generator.function(unit, false);
+                } else {
+                    generator.literal(unit, size / 4);
+                }
+                break;
+        }
+
+        if (out.size() + unit.size() > size) {
+            misses++;
+            continue;
+        }
+
+        misses = 0;
+        out += unit;
+    }
+
+    return out;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "../include/common.h"
+
+NAMESPACE_BEGIN
+namespace bench {
+
+/**
+ * @brief What a generated Mara program is mostly made of. All of them are shaped like
+ *        examples/syntax.ra, only the mix of declarations, functions, comments and literals differs.
+ */
+enum class Shape : std::uint8_t {
+    // declarations and functions with indented bodies, a few comments
+    mixed,
+    // line and block comments, doc comments under function headers
+    comments,
+    // number and string literals, some of them long
+    literals,
+};
+
+std::string_view shapeName(Shape shape);
+
+/**
+ * @brief A Mara program of at most size bytes, made of whole declarations, functions and comments.
+ *        The same shape, size and seed always give the same program.
+ */
+std::string generateCorpus(Shape shape, std::size_t size, std::uint64_t seed = 1);
+
+}  // namespace bench
+NAMESPACE_END
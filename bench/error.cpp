@@ -0,0 +1,58 @@
+#include "bench.h"
+
+#include "../include/tree.h"
+
+using namespace NAMESPACE;
+
+namespace {
+
+using Check = maybe<std::uint64_t, TreeError> (*)(std::uint64_t value);
+
+maybe<std::uint64_t, TreeError> succeed(std::uint64_t value) { return std::move(value); }
+
+// the error of a destroyed tree has a message too long to be stored inline, so returning it allocates
+maybe<std::uint64_t, TreeError> failWithMessage(std::uint64_t) { return TreeErrorCode::tree_already_destroyed; }
+
+maybe<std::uint64_t, TreeError> fail(std::uint64_t) { return TreeError(1 << 1); }
+
+// Called through a pointer set before timing so the return isn't inlined into the loop and folded away
+Check &check() {
+    static Check check = nullptr;
+    return check;
+}
+
+template<Check C>
+bench::Throughput use() {
+    check() = C;
+    return {};
+}
+
+std::uint64_t checkAll(std::uint64_t iterations) {
+    auto call = check();
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        auto result = call(i);
+        sum += result.has_value() ? result.value() : result.error().value;
+    }
+    return sum;
+}
+
+bench::Benchmark success("maybe/success", 0, use<succeed>, checkAll);
+
+bench::Benchmark error("maybe/error without message", 0, use<fail>, checkAll);
+
+bench::Benchmark error_message("maybe/error with message", 0, use<failWithMessage>, checkAll);
+
+bench::Benchmark flags("ErrorType/combine and test flags", [](std::uint64_t iterations) {
+    const auto both = TreeErrorCode::tree_already_destroyed | TreeErrorCode::only_single_root_allowed;
+
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        const auto error = TreeError(static_cast<unsigned>(i) & 0b110);
+        sum += static_cast<unsigned>(error & both);
+        sum += error == TreeErrorCode::tree_already_destroyed;
+    }
+    return sum;
+});
+
+}  // namespace
@@ -0,0 +1,56 @@
+#include "bench.h"
+
+#include "../include/tokenizer/interner.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace NAMESPACE;
+
+namespace {
+
+// Names the way a program repeats them, a few hundred distinct ones used over and over
+const std::vector<std::string> &names() {
+    static const std::vector<std::string> names = [] {
+        std::vector<std::string> result;
+        std::uint32_t state = 12345;
+        for (std::size_t i = 0; i < 4096; ++i) {
+            state = state * 1664525u + 1013904223u;
+            result.push_back("identifier_" + std::to_string((state >> 8) % 500));
+        }
+        return result;
+    }();
+    return names;
+}
+
+template<class Intern>
+std::uint64_t internAll(std::uint64_t iterations, Intern intern) {
+    auto &input = names();
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0, next = 0; i < iterations; ++i) {
+        sum += intern(input[next]);
+        next = next + 1 == input.size() ? 0 : next + 1;
+    }
+    return sum;
+}
+
+bench::Benchmark interner("interner/intern", [](std::uint64_t iterations) {
+    auto names = lexer::Interner();
+    return internAll(iterations, [&](const std::string &text) { return names.intern(text); });
+});
+
+bench::Benchmark concurrent("interner/intern concurrent", [](std::uint64_t iterations) {
+    auto names = lexer::Interner::concurrent();
+    return internAll(iterations, [&](const std::string &text) { return names.intern(text); });
+});
+
+// What a symbol table keyed on owned strings does for every name
+bench::Benchmark strings("interner/unordered_map of strings", [](std::uint64_t iterations) {
+    std::unordered_map<std::string, lexer::NameId> ids;
+    return internAll(iterations, [&](const std::string &text) {
+        return ids.try_emplace(text, static_cast<lexer::NameId>(ids.size() + 1)).first->second;
+    });
+});
+
+}  // namespace
@@ -0,0 +1,89 @@
+#include "bench.h"
+
+#include "../include/tokenizer/grammar.h"
+
+#include <parallel_hashmap/phmap.h>
+
+#include <array>
+#include <vector>
+
+using namespace NAMESPACE;
+using lexer::TokenKind;
+
+namespace {
+
+// Lexemes in the ratio a program has them, mostly identifiers and some keywords and operators
+const std::vector<std::string_view> &lexemes() {
+    static const std::vector<std::string_view> lexemes = [] {
+        constexpr std::array<std::string_view, 11> keywords = {"as", "::", "return", "mutable", ":", "=",
+                                                               "!", "?", "(", ")", ","};
+        constexpr std::array<std::string_view, 10> identifiers = {
+                "a", "count", "value", "returns", "as_is", "index", "mutable_state", "x1", "tokenizer",
+                "a_rather_long_identifier"};
+
+        std::vector<std::string_view> result;
+        std::uint32_t state = 12345;
+        for (std::size_t i = 0; i < 4096; ++i) {
+            state = state * 1664525u + 1013904223u;
+            auto pick = state >> 8;
+            if (pick % 10 < 3) {
+                result.push_back(keywords[pick / 10 % keywords.size()]);
+            } else {
+                result.push_back(identifiers[pick / 10 % identifiers.size()]);
+            }
+        }
+        return result;
+    }();
+    return lexemes;
+}
+
+// The comparisons a hand written recognizer does
+TokenKind compareKind(std::string_view text) {
+    if (text == "as" || text == "::") return TokenKind::decl_keyword;
+    if (text == "return") return TokenKind::return_keyword;
+    if (text == "mutable") return TokenKind::mutable_keyword;
+    if (text == ":") return TokenKind::colon;
+    if (text == "=") return TokenKind::assign;
+    if (text == "!") return TokenKind::bang;
+    if (text == "?") return TokenKind::question;
+    if (text == "(") return TokenKind::paren_open;
+    if (text == ")") return TokenKind::paren_close;
+    if (text == ",") return TokenKind::comma;
+    return TokenKind::none;
+}
+
+template<class Classify>
+std::uint64_t classifyAll(std::uint64_t iterations, Classify classify) {
+    auto &input = lexemes();
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0, next = 0; i < iterations; ++i) {
+        sum += static_cast<std::uint64_t>(classify(input[next]));
+        next = next + 1 == input.size() ? 0 : next + 1;
+    }
+    return sum;
+}
+
+bench::Benchmark perfect_hash("keywords/perfect hash", [](std::uint64_t iterations) {
+    return classifyAll(iterations, [](std::string_view text) { return lexer::grammar::keywordKind(text); });
+});
+
+bench::Benchmark comparisons("keywords/comparisons", [](std::uint64_t iterations) {
+    return classifyAll(iterations, compareKind);
+});
+
+bench::Benchmark hash_map("keywords/flat hash map", [](std::uint64_t iterations) {
+    static const phmap::flat_hash_map<std::string_view, TokenKind> kinds = {
+            {"as", TokenKind::decl_keyword},     {"::", TokenKind::decl_keyword},
+            {"return", TokenKind::return_keyword}, {"mutable", TokenKind::mutable_keyword},
+            {":", TokenKind::colon},      {"=", TokenKind::assign},
+            {"!", TokenKind::bang},  {"?", TokenKind::question},
+            {"(", TokenKind::paren_open},  {")", TokenKind::paren_close},
+            {",", TokenKind::comma}};
+
+    return classifyAll(iterations, [](std::string_view text) {
+        auto found = kinds.find(text);
+        return found != kinds.end() ? found->second : TokenKind::none;
+    });
+});
+
+}  // namespace
@@ -0,0 +1,36 @@
+#include "bench.h"
+
+#include "../include/logger.h"
+
+using namespace NAMESPACE;
+
+namespace {
+
+// spdlog's default, trace messages are dropped
+bench::Throughput traceDisabled() {
+    spdlog::set_level(spdlog::level::info);
+    return {};
+}
+
+// logger::trace formats the message before spdlog checks the level, a dropped message costs that much
+bench::Benchmark trace("logger/disabled trace", 0, traceDisabled, [](std::uint64_t iterations) {
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        logger::trace("token {} at {}", i, iterations);
+    }
+    return iterations;
+});
+
+// what a dropped message costs when the level is checked first
+bench::Benchmark guarded("logger/disabled trace, level checked first", 0, traceDisabled,
+                         [](std::uint64_t iterations) {
+                             std::uint64_t logged = 0;
+                             for (std::uint64_t i = 0; i < iterations; ++i) {
+                                 if (spdlog::should_log(spdlog::level::trace)) {
+                                     logger::trace("token {} at {}", i, iterations);
+                                     logged++;
+                                 }
+                             }
+                             return iterations + logged;
+                         });
+
+}  // namespace
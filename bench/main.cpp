@@ -0,0 +1,234 @@
+#include "bench.h"
+
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace NAMESPACE;
+
+namespace {
+
+struct Registered {
+    std::string name;
+    bench::Body body;
+
+    // only set for benchmarks over an input
+    std::uint64_t input_size = 0;
+    bench::Prepare prepare;
+};
+
+// a function local so benchmarks in other files can register during static initialization
+std::vector<Registered> &registry() {
+    static std::vector<Registered> benchmarks;
+    return benchmarks;
+}
+
+// a run shorter than this is timed again with twice the iterations
+constexpr auto min_time = std::chrono::milliseconds(200);
+
+// Starts measuring the peak resident memory over, only Linux can. Elsewhere the peak of the whole
+// process is reported, which only grows.
+void resetPeakRss() {
+#ifdef __linux__
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+std::uint64_t peakRss() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#elif defined(__linux__)
+    // VmHWM is what clear_refs resets, ru_maxrss isn't
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        if (line.starts_with("VmHWM:")) {
+            return std::stoull(line.substr(6)) * 1024;
+        }
+    }
+    return 0;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // bytes on macOS
+    return static_cast<std::uint64_t>(usage.ru_maxrss);
+#endif
+}
+
+// A size like 4096, 64K, 16M or 1G, the suffixes are powers of 1024
+std::optional<std::uint64_t> parseSize(std::string_view text) {
+    std::uint64_t value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end == text.data()) {
+        return std::nullopt;
+    }
+
+    std::string_view suffix(end, text.data() + text.size() - end);
+    if (suffix.empty()) {
+        return value;
+    }
+    if (suffix == "K") {
+        return value << 10;
+    }
+    if (suffix == "M") {
+        return value << 20;
+    }
+    if (suffix == "G") {
+        return value << 30;
+    }
+    return std::nullopt;
+}
+
+// text as a JSON string
+std::string quoted(std::string_view text) {
+    std::string out = "\"";
+    for (char c: text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+void printTable(std::span<const bench::Result> results) {
+    std::cout << std::format("{:<44} {:>12} {:>14} {:>10} {:>10} {:>10} {:>10} {:>20}", "benchmark", "iterations",
+                             "ns/op", "MB/s", "Mtok/s", "ns/token", "RSS MB", "checksum")
+              << '\n';
+
+    for (auto &result: results) {
+        std::cout << std::format("{:<44} {:>12} {:>14.3f} ", result.name, result.iterations, result.nsPerIteration());
+        if (result.throughput.bytes != 0) {
+            std::cout << std::format("{:>10.1f} {:>10.2f} {:>10.2f} ", result.megabytesPerSecond(),
+                                     result.tokensPerSecond() / 1e6, result.nsPerToken());
+        } else {
+            std::cout << std::format("{:>10} {:>10} {:>10} ", "-", "-", "-");
+        }
+        std::cout << std::format("{:>10.1f} {:>20}", static_cast<double>(result.peak_rss) / 1e6, result.checksum)
+                  << '\n';
+    }
+}
+
+}  // namespace
+
+bench::Benchmark::Benchmark(std::string name, Body body) {
+    registry().push_back({std::move(name), std::move(body)});
+}
+
+bench::Benchmark::Benchmark(std::string name, std::uint64_t input_size, Prepare prepare, Body body) {
+    registry().push_back({std::move(name), std::move(body), input_size, std::move(prepare)});
+}
+
+std::vector<bench::Result> bench::run(const Options &options) {
+    std::vector<Result> results;
+
+    for (auto &benchmark: registry()) {
+        if (benchmark.name.find(options.filter) == std::string::npos || benchmark.input_size > options.max_input) {
+            continue;
+        }
+
+        Result result;
+        result.name = benchmark.name;
+
+        resetPeakRss();
+        if (benchmark.prepare) {
+            result.throughput = benchmark.prepare();
+        }
+
+        for (std::uint64_t iterations = 1;; iterations *= 2) {
+            const auto start = std::chrono::steady_clock::now();
+            result.checksum = benchmark.body(iterations);
+            result.time = std::chrono::steady_clock::now() - start;
+            result.iterations = iterations;
+
+            if (result.time >= min_time) {
+                break;
+            }
+        }
+
+        result.peak_rss = peakRss();
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+std::string bench::toJson(std::span<const Result> results) {
+    std::string out = "{\n  \"benchmarks\": [";
+
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        auto &result = results[i];
+        out += i == 0 ? "\n" : ",\n";
+        out += std::format("    {{\"name\": {}, \"iterations\": {}, \"ns_per_iteration\": {:.3f}, \"checksum\": {}, "
+                           "\"peak_rss_bytes\": {}",
+                           quoted(result.name), result.iterations, result.nsPerIteration(), result.checksum,
+                           result.peak_rss);
+
+        if (result.throughput.bytes != 0) {
+            out += std::format(", \"bytes\": {}, \"tokens\": {}, \"mb_per_second\": {:.3f}, "
+                               "\"tokens_per_second\": {:.1f}, \"ns_per_token\": {:.3f}",
+                               result.throughput.bytes, result.throughput.tokens, result.megabytesPerSecond(),
+                               result.tokensPerSecond(), result.nsPerToken());
+        }
+        out += "}";
+    }
+
+    out += results.empty() ? "]\n}\n" : "\n  ]\n}\n";
+    return out;
+}
+
+int bench::main(std::span<const std::string_view> args) {
+    Options options;
+    bool filtered = false;
+
+    for (auto arg: args) {
+        if (arg == "--json") {
+            options.json = true;
+        } else if (arg.starts_with("--max-input=")) {
+            auto size = parseSize(arg.substr(12));
+            if (!size) {
+                std::cerr << "rara-bench: --max-input takes a size like 4096, 64K, 16M or 1G" << std::endl;
+                return 2;
+            }
+            options.max_input = *size;
+        } else if (!arg.starts_with("--") && !filtered) {
+            options.filter = arg;
+            filtered = true;
+        } else {
+            std::cerr << "usage: rara-bench [--json] [--max-input=<size>] [filter]" << std::endl;
+            return 2;
+        }
+    }
+
+    auto results = run(options);
+    if (options.json) {
+        std::cout << toJson(results);
+    } else {
+        printTable(results);
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string_view> args(argv + 1, argv + argc);
+    return bench::main(args);
+}
@@ -0,0 +1,84 @@
+#include "bench.h"
+
+#include "../include/tokenizer/number.h"
+
+#include <charconv>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace NAMESPACE;
+
+namespace {
+
+// Literals the way generated constant tables have them, integers of any length and short reals
+const std::vector<std::string> &literals() {
+    static const std::vector<std::string> literals = [] {
+        std::vector<std::string> result;
+        std::uint64_t state = 12345;
+        for (std::size_t i = 0; i < 4096; ++i) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            auto digits = std::to_string(state >> (state % 48 + 1));
+            if (i % 2 == 0) {
+                digits += "." + std::to_string((state >> 40) % 100000);
+            }
+            result.push_back(std::move(digits));
+        }
+        return result;
+    }();
+    return literals;
+}
+
+template<class Decode>
+std::uint64_t decodeAll(std::uint64_t iterations, Decode decode) {
+    auto &input = literals();
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0, next = 0; i < iterations; ++i) {
+        sum += decode(input[next]);
+        next = next + 1 == input.size() ? 0 : next + 1;
+    }
+    return sum;
+}
+
+// integers as they are, reals by their bits
+std::uint64_t checksum(const lexer::Number &number) {
+    if (number.type == lexer::Number::Type::integer) {
+        return static_cast<std::uint64_t>(number.integer);
+    }
+    std::uint64_t bits;
+    std::memcpy(&bits, &number.real, sizeof(bits));
+    return bits;
+}
+
+bench::Benchmark decode("numbers/decodeNumber", [](std::uint64_t iterations) {
+    return decodeAll(iterations, [](const std::string &text) { return checksum(lexer::decodeNumber(text)); });
+});
+
+bench::Benchmark fromChars("numbers/from_chars", [](std::uint64_t iterations) {
+    return decodeAll(iterations, [](const std::string &text) {
+        lexer::Number number;
+        if (text.find('.') == std::string::npos) {
+            std::from_chars(text.data(), text.data() + text.size(), number.integer);
+        } else {
+            number.type = lexer::Number::Type::real;
+            std::from_chars(text.data(), text.data() + text.size(), number.real);
+        }
+        return checksum(number);
+    });
+});
+
+bench::Benchmark strtod("numbers/strtoll and strtod", [](std::uint64_t iterations) {
+    return decodeAll(iterations, [](const std::string &text) {
+        lexer::Number number;
+        if (text.find('.') == std::string::npos) {
+            number.integer = std::strtoll(text.c_str(), nullptr, 10);
+        } else {
+            number.type = lexer::Number::Type::real;
+            number.real = std::strtod(text.c_str(), nullptr);
+        }
+        return checksum(number);
+    });
+});
+
+}  // namespace
@@ -0,0 +1,52 @@
+#include "bench.h"
+
+#include "../include/tokenizer/regex_tokenizer.h"
+
+#include <regex>
+#include <string>
+
+using namespace NAMESPACE;
+
+namespace {
+
+const std::string &program() {
+    static const std::string program = [] {
+        std::string result;
+        for (int i = 0; i < 256; ++i) {
+            result += "count_" + std::to_string(i) + " :: 12.5\nreturn (value, other)? mutable as x\n";
+        }
+        return result;
+    }();
+    return program;
+}
+
+bench::Benchmark combined("regex tokenizer/combined dfa", [](std::uint64_t iterations) {
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        auto tokenizer = lexer::RegexTokenizer{program()};
+        sum += tokenizer.tokenize().size();
+    }
+    return sum;
+});
+
+// What RegexTokenizer did before it had a DFA, every instance compiled its own std::regex objects
+// and matched them against each byte on its own
+bench::Benchmark per_byte("regex tokenizer/std::regex per byte", [](std::uint64_t iterations) {
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        std::regex keyword_regex{R"((decl_keyword|return_keyword))"};
+        std::regex identifier_regex{R"([a-zA-Z_][a-zA-Z0-9_]*)"};
+        std::regex number_regex{R"(\d+(\.\d+)?)"};
+
+        for (char c: program()) {
+            std::string current_char(1, c);
+            if (std::regex_match(current_char, keyword_regex) || std::regex_match(current_char, identifier_regex) ||
+                std::regex_match(current_char, number_regex)) {
+                sum++;
+            }
+        }
+    }
+    return sum;
+});
+
+}  // namespace
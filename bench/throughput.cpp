@@ -0,0 +1,168 @@
+#include "bench.h"
+#include "corpus.h"
+
+#include "../include/lexer.h"
+#include "../include/tokenizer/fsm_tokenizer.h"
+#include "../include/tokenizer/grammar.h"
+#include "../include/tokenizer/padded.h"
+#include "../include/tokenizer/regex_tokenizer.h"
+#include "../include/tokenizer/table_tokenizer.h"
+
+#include <array>
+#include <format>
+#include <functional>
+#include <memory>
+
+using namespace NAMESPACE;
+
+namespace {
+
+// Tokenizes the program it was made for once, returns the number of tokens
+using Run = std::function<std::uint64_t()>;
+
+struct Backend {
+    std::string_view name;
+    std::function<Run(lexer::PaddedView program)> make;
+};
+
+// Builds the TokenRule equivalent of a static rule type
+template<class R>
+lexer::TokenRule dynamicRule() {
+    auto rule = lexer::TokenRule{R::name, R::symbol, R::terminator};
+    rule.direction = R::direction;
+    rule.kind = R::kind;
+    rule.opaque = R::opaque;
+    rule.run = R::run;
+    rule.matcher = [](char c, unsigned long index, std::string_view &program) { return R::match(c, index, program); };
+    return rule;
+}
+
+// Mara as rules registered at runtime, the way a grammar is prototyped
+std::unique_ptr<lexer::Tokenizer> dynamicMara(lexer::PaddedView program) {
+    using namespace lexer::grammar;
+
+    auto tokenizer = std::make_unique<lexer::Tokenizer>(program);
+    tokenizer->setLayout(true);
+
+    std::array rules = {dynamicRule<QuotedString>(), dynamicRule<DeclOp>(),    dynamicRule<As>(),
+                        dynamicRule<Return>(),       dynamicRule<Mutable>(),   dynamicRule<Identifier>(),
+                        dynamicRule<Number>(),       dynamicRule<Colon>(),     dynamicRule<Assign>(),
+                        dynamicRule<Bang>(),         dynamicRule<Question>(),  dynamicRule<ParenOpen>(),
+                        dynamicRule<ParenClose>(),   dynamicRule<Comma>()};
+    for (auto &rule: rules) {
+        tokenizer->registerRule(rule);
+    }
+    return tokenizer;
+}
+
+// Mara as FSMs, the same patterns as grammar::MaraPatterns
+std::unique_ptr<lexer::FSMTokenizer> fsmMara(lexer::PaddedView program) {
+    auto tokenizer = std::make_unique<lexer::FSMTokenizer>(program);
+    tokenizer->add_fsm("whitespace", R"([ \t\r\n]+)");
+    tokenizer->add_fsm("comment", R"(--[^\n]*)");
+    tokenizer->add_fsm("block comment", R"(!-([^-]|-+[^-!])*-+!)");
+    tokenizer->add_fsm("string", R"("[^"]*")");
+    tokenizer->add_fsm("decl_keyword", "::|as");
+    tokenizer->add_fsm("return_keyword", "return");
+    tokenizer->add_fsm("mutable_keyword", "mutable");
+    tokenizer->add_fsm("identifier", R"([a-zA-Z_]\w*)");
+    tokenizer->add_fsm("number", R"(\d+(\.\d+)?)");
+    tokenizer->add_fsm("colon", ":");
+    tokenizer->add_fsm("assign", "=");
+    tokenizer->add_fsm("bang", "!");
+    tokenizer->add_fsm("question", R"(\?)");
+    tokenizer->add_fsm("paren_open", R"(\()");
+    tokenizer->add_fsm("paren_close", R"(\))");
+    tokenizer->add_fsm("comma", ",");
+    return tokenizer;
+}
+
+// A run that tokenizes with tokenizer, which is kept for the next runs
+template<class T>
+Run runOf(std::shared_ptr<T> tokenizer) {
+    return [tokenizer] { return tokenizer->tokenize().size(); };
+}
+
+const std::array<Backend, 5> backends = {{
+        {"Tokenizer", [](lexer::PaddedView program) { return runOf(std::shared_ptr(dynamicMara(program))); }},
+        {"TableTokenizer",
+         [](lexer::PaddedView program) {
+             return runOf(std::make_shared<lexer::grammar::MaraTableTokenizer>(program));
+         }},
+        {"FSMTokenizer", [](lexer::PaddedView program) { return runOf(std::shared_ptr(fsmMara(program))); }},
+        {"RegexTokenizer",
+         [](lexer::PaddedView program) { return runOf(std::make_shared<lexer::RegexTokenizer>(program)); }},
+        {"Lexer",
+         [](lexer::PaddedView program) { return runOf(std::make_shared<lexer::Lexer>(std::string(program.text()))); }},
+}};
+
+constexpr std::array<bench::Shape, 3> shapes = {bench::Shape::mixed, bench::Shape::comments, bench::Shape::literals};
+
+constexpr std::array<std::uint64_t, 6> sizes = {1 << 10, 64 << 10, 1 << 20, 16 << 20, 256 << 20, 1 << 30};
+
+std::string sizeName(std::uint64_t size) {
+    if (size >= 1 << 30) {
+        return std::format("{}GB", size >> 30);
+    }
+    if (size >= 1 << 20) {
+        return std::format("{}MB", size >> 20);
+    }
+    return std::format("{}KB", size >> 10);
+}
+
+// Only the corpus and tokenizer of the benchmark that runs are kept, a 1 GB corpus is plenty
+struct Current {
+    bench::Shape shape = bench::Shape::mixed;
+    std::uint64_t size = 0;
+    lexer::PaddedString corpus;
+
+    Run run;
+};
+
+Current &current() {
+    static Current current;
+    return current;
+}
+
+// Generates the corpus unless it's the current one already and makes the tokenizer of backend for it
+bench::Throughput prepare(const Backend &backend, bench::Shape shape, std::uint64_t size) {
+    auto &state = current();
+
+    // the last tokenizer can refer to the corpus
+    state.run = nullptr;
+
+    if (state.size != size || state.shape != shape) {
+        state.corpus = lexer::PaddedString();
+        state.corpus = lexer::PaddedString(bench::generateCorpus(shape, size));
+        state.shape = shape;
+        state.size = size;
+    }
+
+    state.run = backend.make(state.corpus.view());
+
+    // the first run counts the tokens and warms up
+    return {state.corpus.size(), state.run()};
+}
+
+// in order of size, so all backends run over a corpus before the next one is generated
+const bool registered = [] {
+    for (auto size: sizes) {
+        for (auto shape: shapes) {
+            for (auto &backend: backends) {
+                auto name = std::format("throughput/{}/{}/{}", backend.name, bench::shapeName(shape), sizeName(size));
+                bench::Benchmark(
+                        std::move(name), size, [&backend, shape, size] { return prepare(backend, shape, size); },
+                        [](std::uint64_t iterations) {
+                            std::uint64_t sum = 0;
+                            for (std::uint64_t i = 0; i < iterations; ++i) {
+                                sum += current().run();
+                            }
+                            return sum;
+                        });
+            }
+        }
+    }
+    return true;
+}();
+
+}  // namespace
@@ -0,0 +1,112 @@
+#include "bench.h"
+
+#include "../include/tree.h"
+
+#include <deque>
+#include <memory>
+
+using namespace NAMESPACE;
+
+namespace {
+
+// Nodes of the tree the iteration benchmarks walk
+constexpr int tree_size = 1'000'000;
+
+// children per node of that tree
+constexpr int fan_out = 8;
+
+// A tree of size nodes valued 0 to size - 1 in breadth-first order, every node has fan_out children
+// until there are enough
+std::unique_ptr<Tree<int>> buildTree(int size, int fan_out) {
+    auto tree = std::make_unique<Tree<int>>(0);
+
+    std::deque<SubTree<int>> parents;
+    parents.push_back(tree->at(tree->root()));
+
+    for (int value = 1; value < size;) {
+        auto parent = std::move(parents.front());
+        parents.pop_front();
+
+        for (int i = 0; i < fan_out && value < size; ++i) {
+            parents.push_back(std::move(parent.add_child(int(value++)).value()));
+        }
+    }
+
+    return tree;
+}
+
+// the tree of the benchmark that runs, built before it's timed
+std::unique_ptr<Tree<int>> &built() {
+    static std::unique_ptr<Tree<int>> tree;
+    return tree;
+}
+
+bench::Benchmark add_child("tree/add_child", [](std::uint64_t iterations) {
+    Tree<int> tree(0);
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        tree.add_child(static_cast<int>(i));
+    }
+    return static_cast<std::uint64_t>(tree.unsafe_children_size());
+});
+
+bench::Benchmark breadth_first(
+        "tree/breadth-first iteration over 10^6 nodes", 0,
+        [] {
+            built() = nullptr;
+            built() = buildTree(tree_size, fan_out);
+            return bench::Throughput{};
+        },
+        [](std::uint64_t iterations) {
+            auto &tree = *built();
+
+            std::uint64_t sum = 0;
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                for (auto it = tree.unsafe_iter(); tree.is_valid(it); ++it) {
+                    sum += static_cast<std::uint64_t>(*it);
+                }
+            }
+            return sum;
+        });
+
+// children_size and depth_size count the children one by one, so a wide node costs more
+template<int children>
+bench::Throughput wideNode() {
+    built() = nullptr;
+    built() = buildTree(children + 1, children);
+    return {};
+}
+
+bench::Benchmark children_size_10("tree/children_size of 10 children", 0, wideNode<10>, [](std::uint64_t iterations) {
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        sum += built()->unsafe_children_size();
+    }
+    return sum;
+});
+
+bench::Benchmark children_size_1000("tree/children_size of 1000 children", 0, wideNode<1000>,
+                                    [](std::uint64_t iterations) {
+                                        std::uint64_t sum = 0;
+                                        for (std::uint64_t i = 0; i < iterations; ++i) {
+                                            sum += built()->unsafe_children_size();
+                                        }
+                                        return sum;
+                                    });
+
+bench::Benchmark depth_size_10("tree/depth_size of 10 children", 0, wideNode<10>, [](std::uint64_t iterations) {
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        sum += built()->unsafe_depth_size();
+    }
+    return sum;
+});
+
+bench::Benchmark depth_size_1000("tree/depth_size of 1000 children", 0, wideNode<1000>, [](std::uint64_t iterations) {
+    std::uint64_t sum = 0;
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+        sum += built()->unsafe_depth_size();
+    }
+    return sum;
+});
+
+}  // namespace
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "thread_pool.h"
+#include "tokenizer/interner.h"
+
+NAMESPACE_BEGIN
+
+/**
+ * @brief Batch mode of the compiler, `rara build dir [-j N]` runs the front end on every .ra file
+ *        under dir on a thread pool.
+ */
+namespace driver {
+
+struct FileResult {
+    std::filesystem::path path;
+
+    std::size_t bytes = 0;
+    std::size_t tokens = 0;
+
+    std::chrono::nanoseconds wall{};
+    std::chrono::nanoseconds cpu{};
+
+    // empty unless the file couldn't be read
+    std::string error;
+};
+
+// CPU time used by the calling thread
+std::chrono::nanoseconds threadCpuTime();
+
+// CPU time used by all threads of the process
+std::chrono::nanoseconds processCpuTime();
+
+// The .ra files under root, sorted so builds visit them in the same order every time
+std::vector<std::filesystem::path> findSources(const std::filesystem::path &root);
+
+// Reads and lexes one file, its identifiers are interned into names if there are any
+FileResult buildFile(const std::filesystem::path &path, lexer::Interner *names = nullptr);
+
+// Runs buildFile for every file as a task on pool, the results are in the order of files. names
+// is shared by the tasks, so it has to be concurrent.
+std::vector<FileResult> buildFiles(const std::vector<std::filesystem::path> &files, ThreadPool &pool,
+                                   lexer::Interner *names = nullptr);
+
+// Runs the build command, args are the arguments after "build". Returns the exit code.
+int build(std::span<const std::string_view> args);
+
+}  // namespace driver
+
+NAMESPACE_END
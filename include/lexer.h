@@ -6,6 +6,9 @@
 #include <vector>
 
 #include "./common.h"
+#include "./source_file.h"
+#include "./tokenizer/grammar.h"
+#include "./tokenizer/interner.h"
 #include "./tokenizer/tokenizer.h"
 
 NAMESPACE_BEGIN
@@ -23,13 +26,33 @@ class Lexer {
 public:
   Lexer( std::string program );
 
+  /**
+   * @brief Lexes the text of file without copying it, file has to outlive the lexer.
+   */
+  explicit Lexer( const SourceFile& file );
+
   /**
    * @brief Tokenizes the program and returns a vector of tokens.
    */
-  std::vector<Token> tokenize();
+  TokenStream tokenize();
+
+  /**
+   * @brief Tokenizes the program and gives its identifiers their ids in names.
+   */
+  TokenStream tokenize( Interner& names );
+
+  /**
+   * @brief A tokenizer over the program to pull tokens from one at a time with next() and peek(),
+   *        it refers to the program so it can't outlive the lexer.
+   */
+  grammar::MaraTokenizer tokenizer() const;
 
 private:
-  std::string program;
+  // The text to lex, either the owned program or the file
+  PaddedView source() const;
+
+  PaddedString program;
+  const SourceFile* file = nullptr;
 };
 
 }  // namespace lexer
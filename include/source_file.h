@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <istream>
+#include <string>
+#include <string_view>
+
+#include "common.h"
+#include "tokenizer/padded.h"
+
+NAMESPACE_BEGIN
+
+/**
+ * @brief The text of a source file. Regular files are memory mapped read only and read front to
+ *        back, so the tokenizer gets a view of the file without a copy. Anything that can't be
+ *        mapped, like a pipe, is read into a buffer the SourceFile owns. Either way the text is
+ *        followed by lexer::padding zero bytes.
+ */
+class SourceFile {
+public:
+    SourceFile() = default;
+
+    // Throws std::system_error if path can't be opened or read
+    static SourceFile open(const std::filesystem::path &path);
+
+    // Reads all of stream, e.g. std::cin
+    static SourceFile read(std::istream &stream);
+
+    SourceFile(SourceFile &&other) noexcept;
+
+    SourceFile &operator=(SourceFile &&other) noexcept;
+
+    SourceFile(const SourceFile &) = delete;
+    SourceFile &operator=(const SourceFile &) = delete;
+
+    ~SourceFile();
+
+    // Valid as long as the SourceFile is
+    [[nodiscard]] std::string_view text() const { return {_data, _size}; }
+
+    [[nodiscard]] lexer::PaddedView padded() const {
+        return lexer::PaddedView::assume(text());
+    }
+
+    [[nodiscard]] std::size_t size() const { return _size; }
+
+    [[nodiscard]] bool mapped() const { return _mapping != nullptr; }
+
+    [[nodiscard]] const std::filesystem::path &path() const { return _path; }
+
+private:
+    void unmap();
+
+    std::filesystem::path _path;
+
+    // the zeros of an empty PaddedView while there is no text, so the text is always padded
+    const char *_data = lexer::PaddedView().data();
+    std::size_t _size = 0;
+
+    // start of the mapped view and its length with the padding, null if the text is in _buffer
+    void *_mapping = nullptr;
+    std::size_t _mapped_length = 0;
+
+    // the text and its padding
+    std::string _buffer;
+
+    // Points _data at _buffer after padding it
+    void useBuffer();
+
+    // Points _data at the mapping, the buffer or the zeros if there is neither
+    void useData();
+};
+
+NAMESPACE_END
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "common.h"
+
+NAMESPACE_BEGIN
+
+/**
+ * @brief A work stealing thread pool. Every worker has its own queue, tasks submitted by a task
+ *        go to the back of its worker's queue and are run from there first, newest first. A worker
+ *        with nothing left takes the oldest task of another queue. Tasks submitted from outside
+ *        are spread over the queues in turn. The destructor finishes all tasks before joining.
+ */
+class ThreadPool {
+public:
+    // One worker per hardware thread if threads is 0
+    explicit ThreadPool(std::size_t threads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    [[nodiscard]] std::size_t size() const { return _workers.size(); }
+
+    // Queues task, the future holds its result or the exception it threw
+    template<class F>
+    auto submit(F &&task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+
+        // std::function has to be copyable, packaged_task isn't
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        auto future = packaged->get_future();
+
+        push([packaged] { (*packaged)(); });
+        return future;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void push(std::function<void()> task);
+
+    // Takes the newest task of the worker's own queue or the oldest of another one
+    bool take(std::size_t worker, std::function<void()> &task);
+
+    void work(std::size_t worker);
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+
+    // queue of the next task submitted from outside the pool
+    std::atomic<std::size_t> _next = 0;
+
+    // tasks queued and not taken yet, guarded by _mutex like _stopping
+    std::size_t _pending = 0;
+    bool _stopping = false;
+
+    std::mutex _mutex;
+    std::condition_variable _ready;
+};
+
+NAMESPACE_END
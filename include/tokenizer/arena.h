@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "../common.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief Bump allocator for texts, they are never freed one by one. Texts are copied into blocks of
+ *        block_size bytes, a text longer than that gets a block of its own. Stored texts stay valid
+ *        as long as the arena.
+ */
+class Arena {
+public:
+    // Room for size bytes, valid until the arena is destroyed
+    char *allocate(std::size_t size) {
+        if (size > _left) {
+            auto block = std::max(size, block_size);
+            _blocks.push_back(std::make_unique<char[]>(block));
+            _next = _blocks.back().get();
+            _left = block;
+        }
+
+        auto *allocated = _next;
+        _next += size;
+        _left -= size;
+        return allocated;
+    }
+
+    // Hands back the last unused bytes of the last allocation
+    void release(std::size_t unused) {
+        _next -= unused;
+        _left += unused;
+    }
+
+    std::string_view store(std::string_view text) {
+        auto *stored = allocate(text.size());
+        if (!text.empty()) {
+            std::memcpy(stored, text.data(), text.size());
+        }
+        return {stored, text.size()};
+    }
+
+private:
+    static constexpr std::size_t block_size = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    char *_next = nullptr;
+    std::size_t _left = 0;
+};
+
+}  // namespace lexer
+NAMESPACE_END
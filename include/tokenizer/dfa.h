@@ -0,0 +1,719 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../common.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief Compiles a list of patterns into one minimized DFA.
+ *
+ * Everything here is constexpr, so the same code builds tables at compile time (see compileTable)
+ * and at runtime (see compile). Supported pattern syntax:
+ *
+ *   abc       literal bytes
+ *   .         any byte but \n
+ *   [a-z_]    byte class, [^...] negates it
+ *   \d \w \s  digit, word and whitespace classes, \n \t \r and \<c> for a literal c
+ *   (...)     group
+ *   a|b       alternation
+ *   * + ?     repetition
+ *
+ * The DFA accepts the index of the pattern that matched, earlier patterns win when two patterns
+ * match the same text.
+ */
+namespace dfa {
+
+constexpr std::uint16_t dead = 0;
+constexpr std::uint16_t start = 1;
+
+struct ByteSet {
+    std::array<std::uint64_t, 4> bits{};
+
+    constexpr void add(unsigned char b) { bits[b >> 6] |= std::uint64_t(1) << (b & 63); }
+
+    constexpr void addRange(unsigned char lo, unsigned char hi) {
+        for (unsigned c = lo; c <= hi; ++c) {
+            add(static_cast<unsigned char>(c));
+        }
+    }
+
+    constexpr void merge(const ByteSet &other) {
+        for (std::size_t i = 0; i < bits.size(); ++i) {
+            bits[i] |= other.bits[i];
+        }
+    }
+
+    constexpr void invert() {
+        for (auto &word: bits) {
+            word = ~word;
+        }
+    }
+
+    [[nodiscard]] constexpr bool has(unsigned char b) const { return (bits[b >> 6] >> (b & 63)) & 1; }
+
+    constexpr bool operator==(const ByteSet &other) const = default;
+};
+
+/**
+ * @brief A Thompson NFA state, either a byte transition to next or up to two epsilon transitions.
+ */
+struct NfaState {
+    ByteSet bytes;
+    int next = -1;
+    int eps1 = -1;
+    int eps2 = -1;
+
+    // index of the pattern accepted here, or -1
+    int accept = -1;
+};
+
+struct Fragment {
+    int start;
+    int end;
+};
+
+// not constexpr, so a malformed pattern is a compile error in compileTable
+[[noreturn]] inline void fail(const char *message) {
+    throw std::invalid_argument(message);
+}
+
+/**
+ * @brief Parses patterns into NFA fragments. The end state of a fragment never has outgoing
+ *        transitions, so it can be patched when fragments are joined.
+ */
+class NfaBuilder {
+public:
+    std::vector<NfaState> states;
+
+    constexpr Fragment parse(std::string_view pattern) {
+        _pattern = pattern;
+        _pos = 0;
+
+        auto fragment = alternation();
+        if (more()) {
+            fail("unbalanced ')' in pattern");
+        }
+        return fragment;
+    }
+
+private:
+    std::string_view _pattern;
+    std::size_t _pos = 0;
+
+    [[nodiscard]] constexpr bool more() const { return _pos < _pattern.size(); }
+
+    [[nodiscard]] constexpr char peek() const { return _pattern[_pos]; }
+
+    constexpr char take() {
+        if (!more()) {
+            fail("unexpected end of pattern");
+        }
+        return _pattern[_pos++];
+    }
+
+    constexpr int add() {
+        states.push_back({});
+        return static_cast<int>(states.size()) - 1;
+    }
+
+    constexpr Fragment alternation() {
+        auto left = concatenation();
+
+        while (more() && peek() == '|') {
+            _pos++;
+            auto right = concatenation();
+
+            int s = add();
+            int e = add();
+            states[s].eps1 = left.start;
+            states[s].eps2 = right.start;
+            states[left.end].eps1 = e;
+            states[right.end].eps1 = e;
+            left = {s, e};
+        }
+
+        return left;
+    }
+
+    constexpr Fragment concatenation() {
+        int s = add();
+        Fragment result = {s, s};
+
+        while (more() && peek() != '|' && peek() != ')') {
+            auto fragment = repetition();
+            states[result.end].eps1 = fragment.start;
+            result.end = fragment.end;
+        }
+
+        return result;
+    }
+
+    constexpr Fragment repetition() {
+        auto fragment = atom();
+
+        while (more() && (peek() == '*' || peek() == '+' || peek() == '?')) {
+            char op = take();
+
+            int s = add();
+            int e = add();
+            states[s].eps1 = fragment.start;
+
+            switch (op) {
+                case '*':
+                    states[s].eps2 = e;
+                    states[fragment.end].eps1 = fragment.start;
+                    states[fragment.end].eps2 = e;
+                    break;
+                case '+':
+                    states[fragment.end].eps1 = fragment.start;
+                    states[fragment.end].eps2 = e;
+                    break;
+                default:
+                    states[s].eps2 = e;
+                    states[fragment.end].eps1 = e;
+                    break;
+            }
+
+            fragment = {s, e};
+        }
+
+        return fragment;
+    }
+
+    constexpr Fragment atom() {
+        ByteSet set;
+
+        char c = take();
+        switch (c) {
+            case '(': {
+                auto fragment = alternation();
+                if (!more() || take() != ')') {
+                    fail("missing ')' in pattern");
+                }
+                return fragment;
+            }
+            case '[':
+                set = byteClass();
+                break;
+            case '.':
+                set.add('\n');
+                set.invert();
+                break;
+            case '\\':
+                set = escape(take());
+                break;
+            case '*':
+            case '+':
+            case '?':
+            case ')':
+            case '|':
+                fail("unexpected operator in pattern");
+                break;
+            default:
+                set.add(static_cast<unsigned char>(c));
+                break;
+        }
+
+        int s = add();
+        int e = add();
+        states[s].bytes = set;
+        states[s].next = e;
+        return {s, e};
+    }
+
+    static constexpr char escapedChar(char c) {
+        switch (c) {
+            case 'n':
+                return '\n';
+            case 't':
+                return '\t';
+            case 'r':
+                return '\r';
+            default:
+                return c;
+        }
+    }
+
+    static constexpr ByteSet escape(char c) {
+        ByteSet set;
+        switch (c) {
+            case 'd':
+                set.addRange('0', '9');
+                break;
+            case 'w':
+                set.addRange('a', 'z');
+                set.addRange('A', 'Z');
+                set.addRange('0', '9');
+                set.add('_');
+                break;
+            case 's':
+                for (char ws: std::string_view(" \t\r\n\f\v")) {
+                    set.add(static_cast<unsigned char>(ws));
+                }
+                break;
+            default:
+                set.add(static_cast<unsigned char>(escapedChar(c)));
+                break;
+        }
+        return set;
+    }
+
+    constexpr ByteSet byteClass() {
+        ByteSet set;
+
+        bool negate = more() && peek() == '^';
+        if (negate) {
+            _pos++;
+        }
+
+        while (more() && peek() != ']') {
+            char lo = take();
+
+            if (lo == '\\') {
+                char e = take();
+                if (e == 'd' || e == 'w' || e == 's') {
+                    set.merge(escape(e));
+                    continue;
+                }
+                lo = escapedChar(e);
+            }
+
+            char hi = lo;
+            if (_pos + 1 < _pattern.size() && peek() == '-' && _pattern[_pos + 1] != ']') {
+                _pos++;
+                hi = take();
+                if (hi == '\\') {
+                    hi = escapedChar(take());
+                }
+            }
+
+            set.addRange(static_cast<unsigned char>(lo), static_cast<unsigned char>(hi));
+        }
+
+        if (take() != ']') {
+            fail("missing ']' in pattern");
+        }
+
+        if (negate) {
+            set.invert();
+        }
+
+        return set;
+    }
+};
+
+struct DfaView {
+    const std::uint16_t *next;
+    const std::int16_t *accept;
+};
+
+/**
+ * @brief A DFA built at runtime. next[state * 256 + byte] is the next state,
+ *        state 0 is the dead state and state 1 the start state.
+ */
+struct Dfa {
+    std::vector<std::uint16_t> next;
+
+    // index of the pattern accepted in a state, or -1
+    std::vector<std::int16_t> accept;
+
+    [[nodiscard]] constexpr std::size_t states() const { return accept.size(); }
+
+    [[nodiscard]] constexpr DfaView view() const { return {next.data(), accept.data()}; }
+};
+
+/**
+ * @brief A DFA built at compile time, same layout as Dfa.
+ */
+template<std::size_t States>
+struct Table {
+    std::array<std::uint16_t, States * 256> next{};
+    std::array<std::int16_t, States> accept{};
+
+    [[nodiscard]] static constexpr std::size_t states() { return States; }
+
+    [[nodiscard]] constexpr DfaView view() const { return {next.data(), accept.data()}; }
+};
+
+// NFA state sets, one bit per state
+using StateSet = std::vector<std::uint64_t>;
+
+constexpr bool contains(const StateSet &set, int state) {
+    return (set[state >> 6] >> (state & 63)) & 1;
+}
+
+// Adds everything reachable through epsilon transitions, stack holds the states that were just added
+constexpr void closure(const std::vector<NfaState> &nfa, StateSet &set, std::vector<int> &stack) {
+    while (!stack.empty()) {
+        auto s = stack.back();
+        stack.pop_back();
+
+        if (auto e = nfa[s].eps1; e >= 0 && !contains(set, e)) {
+            set[e >> 6] |= std::uint64_t(1) << (e & 63);
+            stack.push_back(e);
+        }
+        if (auto e = nfa[s].eps2; e >= 0 && !contains(set, e)) {
+            set[e >> 6] |= std::uint64_t(1) << (e & 63);
+            stack.push_back(e);
+        }
+    }
+}
+
+/**
+ * @brief Builds the minimized DFA of an NFA, the end state of pattern i is ends[i].
+ */
+constexpr Dfa build(const std::vector<NfaState> &nfa, std::span<const int> starts, std::span<const int> ends) {
+    const auto words = (nfa.size() + 63) / 64;
+
+    // bytes that every transition treats the same way share a class
+    std::vector<ByteSet> distinct;
+    for (const auto &state: nfa) {
+        if (state.next >= 0 && std::find(distinct.begin(), distinct.end(), state.bytes) == distinct.end()) {
+            distinct.push_back(state.bytes);
+        }
+    }
+
+    std::array<int, 256> class_of{};
+    int classes = 1;
+    for (const auto &bytes: distinct) {
+        std::vector<int> remap(classes * 2, -1);
+
+        int count = 0;
+        for (int b = 0; b < 256; ++b) {
+            auto key = class_of[b] * 2 + (bytes.has(static_cast<unsigned char>(b)) ? 1 : 0);
+            if (remap[key] < 0) {
+                remap[key] = count++;
+            }
+            class_of[b] = remap[key];
+        }
+        classes = count;
+    }
+
+    std::vector<int> representative(classes, -1);
+    for (int b = 0; b < 256; ++b) {
+        if (representative[class_of[b]] < 0) {
+            representative[class_of[b]] = b;
+        }
+    }
+
+    // classes each byte transition is taken on
+    std::vector<std::vector<int>> covers(nfa.size());
+    for (std::size_t i = 0; i < nfa.size(); ++i) {
+        for (int k = 0; nfa[i].next >= 0 && k < classes; ++k) {
+            if (nfa[i].bytes.has(static_cast<unsigned char>(representative[k]))) {
+                covers[i].push_back(k);
+            }
+        }
+    }
+
+    // subset construction, set 0 is the empty (dead) set
+    std::vector<StateSet> sets;
+    std::vector<std::uint64_t> hashes;
+    std::vector<int> transitions;
+    std::vector<int> stack;
+
+    auto hash = [](const StateSet &set) {
+        std::uint64_t h = 0;
+        for (auto w: set) {
+            h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+        }
+        return h;
+    };
+
+    sets.push_back(StateSet(words, 0));
+    hashes.push_back(hash(sets[0]));
+
+    StateSet initial(words, 0);
+    for (auto s: starts) {
+        initial[s >> 6] |= std::uint64_t(1) << (s & 63);
+        stack.push_back(s);
+    }
+    closure(nfa, initial, stack);
+    sets.push_back(initial);
+    hashes.push_back(hash(initial));
+
+    for (std::size_t current = 0; current < sets.size(); ++current) {
+        // moves on every class at once, words of class k start at k * words
+        std::vector<std::uint64_t> moves(classes * words, 0);
+        for (std::size_t w = 0; w < words; ++w) {
+            for (auto bits = sets[current][w]; bits != 0; bits &= bits - 1) {
+                auto i = static_cast<int>(w * 64 + std::countr_zero(bits));
+                auto next = nfa[i].next;
+                for (auto k: covers[i]) {
+                    moves[k * words + (next >> 6)] |= std::uint64_t(1) << (next & 63);
+                }
+            }
+        }
+
+        for (int k = 0; k < classes; ++k) {
+            for (std::size_t w = 0; w < words; ++w) {
+                for (auto bits = moves[k * words + w]; bits != 0; bits &= bits - 1) {
+                    stack.push_back(static_cast<int>(w * 64 + std::countr_zero(bits)));
+                }
+            }
+
+            // most bytes lead nowhere
+            if (stack.empty()) {
+                transitions.push_back(dead);
+                continue;
+            }
+
+            StateSet moved(moves.begin() + k * words, moves.begin() + (k + 1) * words);
+
+            closure(nfa, moved, stack);
+
+            auto h = hash(moved);
+            std::size_t target = 1;
+            while (target < sets.size() && (hashes[target] != h || sets[target] != moved)) {
+                target++;
+            }
+            if (target == sets.size()) {
+                sets.push_back(moved);
+                hashes.push_back(h);
+            }
+
+            transitions.push_back(static_cast<int>(target));
+        }
+    }
+
+    const auto count = sets.size();
+
+    std::vector<int> accept(count, -1);
+    for (std::size_t s = 0; s < count; ++s) {
+        for (std::size_t i = 0; i < starts.size(); ++i) {
+            // the end state of pattern i is the only state accepting it, lower indices win
+            if (contains(sets[s], ends[i])) {
+                accept[s] = static_cast<int>(i);
+                break;
+            }
+        }
+    }
+
+    // minimization, split blocks of states until states in a block can't be told apart
+    std::vector<int> block(count, 0);
+    std::size_t blocks = 0;
+    for (std::size_t s = 0; s < count; ++s) {
+        block[s] = accept[s] + 1;
+    }
+
+    while (true) {
+        std::vector<int> refined(count, -1);
+        std::vector<std::size_t> leaders;
+
+        for (std::size_t s = 0; s < count; ++s) {
+            for (std::size_t l = 0; l < leaders.size() && refined[s] < 0; ++l) {
+                auto t = leaders[l];
+                bool same = block[s] == block[t];
+                for (int k = 0; same && k < classes; ++k) {
+                    same = block[transitions[s * classes + k]] == block[transitions[t * classes + k]];
+                }
+                if (same) {
+                    refined[s] = static_cast<int>(l);
+                }
+            }
+
+            if (refined[s] < 0) {
+                refined[s] = static_cast<int>(leaders.size());
+                leaders.push_back(s);
+            }
+        }
+
+        block = refined;
+        if (leaders.size() == blocks) {
+            break;
+        }
+        blocks = leaders.size();
+    }
+
+    if (block[0] == block[1]) {
+        throw std::invalid_argument("patterns don't match anything");
+    }
+
+    // renumber blocks so the dead and start states keep their numbers
+    std::vector<int> order(blocks, -1);
+    std::vector<std::size_t> block_member(blocks, 0);
+    order[block[0]] = dead;
+    order[block[1]] = start;
+
+    int next_id = 2;
+    for (std::size_t s = 0; s < count; ++s) {
+        if (order[block[s]] < 0) {
+            order[block[s]] = next_id++;
+        }
+        block_member[order[block[s]]] = s;
+    }
+
+    Dfa result;
+    result.next.resize(blocks * 256);
+    result.accept.resize(blocks);
+
+    for (std::size_t state = 0; state < blocks; ++state) {
+        auto s = block_member[state];
+        result.accept[state] = static_cast<std::int16_t>(accept[s]);
+
+        for (int b = 0; b < 256; ++b) {
+            auto target = transitions[s * classes + class_of[b]];
+            result.next[state * 256 + b] = static_cast<std::uint16_t>(order[block[target]]);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Compiles patterns into a minimized DFA, throws std::invalid_argument on a malformed pattern.
+ */
+constexpr Dfa compile(std::span<const std::string_view> patterns) {
+    NfaBuilder builder;
+    std::vector<int> starts;
+    std::vector<int> ends;
+
+    for (std::size_t i = 0; i < patterns.size(); ++i) {
+        auto fragment = builder.parse(patterns[i]);
+        builder.states[fragment.end].accept = static_cast<int>(i);
+        starts.push_back(fragment.start);
+        ends.push_back(fragment.end);
+    }
+
+    return build(builder.states, starts, ends);
+}
+
+/**
+ * @brief The NFA of a single pattern, kept around so patterns can be combined later.
+ */
+struct Nfa {
+    std::vector<NfaState> states;
+    Fragment fragment;
+};
+
+/**
+ * @brief Parses a pattern on its own, throws std::invalid_argument if it's malformed.
+ */
+constexpr Nfa parse(std::string_view pattern) {
+    NfaBuilder builder;
+    auto fragment = builder.parse(pattern);
+    return {std::move(builder.states), fragment};
+}
+
+/**
+ * @brief Combines NFAs made by parse into one minimized DFA, pattern i is nfas[i].
+ */
+constexpr Dfa compile(std::span<const Nfa> nfas) {
+    std::vector<NfaState> nfa;
+    std::vector<int> starts;
+    std::vector<int> ends;
+
+    for (std::size_t i = 0; i < nfas.size(); ++i) {
+        auto offset = static_cast<int>(nfa.size());
+        auto shift = [offset](int state) { return state >= 0 ? state + offset : state; };
+
+        for (auto state: nfas[i].states) {
+            state.next = shift(state.next);
+            state.eps1 = shift(state.eps1);
+            state.eps2 = shift(state.eps2);
+            nfa.push_back(state);
+        }
+
+        nfa[nfas[i].fragment.end + offset].accept = static_cast<int>(i);
+        starts.push_back(nfas[i].fragment.start + offset);
+        ends.push_back(nfas[i].fragment.end + offset);
+    }
+
+    return build(nfa, starts, ends);
+}
+
+// Compile time DFAs are built once into a table of MaxStates rows, then copied into one of the
+// right size. Calling compile a second time just to learn the size would double the work.
+template<class Grammar, std::size_t MaxStates>
+struct Bounded {
+    static constexpr auto result = [] {
+        auto dfa = compile(Grammar::patterns);
+        if (dfa.states() > MaxStates) {
+            fail("too many DFA states");
+        }
+
+        std::pair<Table<MaxStates>, std::size_t> result{{}, dfa.states()};
+        for (std::size_t i = 0; i < dfa.next.size(); ++i) {
+            result.first.next[i] = dfa.next[i];
+        }
+        for (std::size_t i = 0; i < dfa.accept.size(); ++i) {
+            result.first.accept[i] = dfa.accept[i];
+        }
+        return result;
+    }();
+};
+
+/**
+ * @brief Compiles Grammar::patterns at compile time.
+ *
+ * @tparam Grammar has a static constexpr std::array<std::string_view, N> patterns
+ * @tparam MaxStates upper bound on the number of DFA states
+ */
+template<class Grammar, std::size_t MaxStates = 128>
+consteval auto compileTable() {
+    constexpr auto &bounded = Bounded<Grammar, MaxStates>::result;
+
+    Table<bounded.second> table;
+    for (std::size_t i = 0; i < table.next.size(); ++i) {
+        table.next[i] = bounded.first.next[i];
+    }
+    for (std::size_t i = 0; i < table.accept.size(); ++i) {
+        table.accept[i] = bounded.first.accept[i];
+    }
+
+    return table;
+}
+
+struct Match {
+    // 0 if no pattern matched
+    std::size_t length = 0;
+    int pattern = -1;
+
+    // the input ended before the DFA died, more input could make the match longer
+    bool more = false;
+
+    // bytes looked at from index, the byte the DFA died on included
+    std::size_t examined = 0;
+};
+
+/**
+ * @brief Returns the longest match of any pattern at index, one table lookup per byte.
+ */
+constexpr Match munch(DfaView dfa, std::string_view input, std::size_t index) {
+    Match match;
+    std::uint16_t state = start;
+    match.examined = input.size() - index;
+
+    for (auto i = index; i < input.size(); ++i) {
+        state = dfa.next[state * 256 + static_cast<unsigned char>(input[i])];
+
+        if (state == dead) {
+            match.examined = i + 1 - index;
+            break;
+        }
+
+        if (dfa.accept[state] >= 0) {
+            match.length = i + 1 - index;
+            match.pattern = dfa.accept[state];
+        }
+    }
+
+    match.more = state != dead;
+    return match;
+}
+
+}  // namespace dfa
+
+}  // namespace lexer
+NAMESPACE_END
@@ -8,49 +8,81 @@
 #include <memory>
 #include <parallel_hashmap/phmap.h>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "./dfa.h"
 #include "./tokenizer.h"
 
 NAMESPACE_BEGIN
 namespace lexer {
 
+/**
+ * @brief A token pattern compiled to an NFA, see dfa.h for the pattern syntax.
+ *        Throws std::invalid_argument if the pattern is malformed.
+ */
 class FSM {
 public:
   FSM(const std::string_view name, const std::string_view pattern);
 
   // move constructor
   FSM(FSM&& other) noexcept
-        : name(std::move(other.name)), pattern(std::move(other.pattern)) {}
+        : name(std::move(other.name)), pattern(std::move(other.pattern)), nfa(std::move(other.nfa)) {}
 
   // copy constructor
   FSM(const FSM& other) = default;
 
+  FSM& operator=(FSM&& other) noexcept = default;
 
+  [[nodiscard]] std::string_view getName() const { return name; }
 
-  // Other FSM-related methods and members
+  [[nodiscard]] std::string_view getPattern() const { return pattern; }
+
+  [[nodiscard]] const dfa::Nfa& getNfa() const { return nfa; }
 
 private:
   std::string_view name;
   std::string_view pattern;
+  dfa::Nfa nfa;
 };
 
+/**
+ * @brief A tokenizer for token patterns registered at runtime. All FSMs are merged into one
+ *        minimized DFA, so the input is scanned once no matter how many token types there are.
+ *        The longest match wins, the FSM registered first wins ties.
+ */
 class FSMTokenizer : public Tokenizer {
 public:
   FSMTokenizer(const std::string_view program);
 
-  // Adds an FSM for a specific token type
+  FSMTokenizer(PaddedView program);
+
+  // Adds an FSM for a specific token type. Tokens are created with the TokenKind named token_name
+  // (see kindOf), text matched by an FSM without a kind is skipped, e.g. "whitespace".
+  // Adding a token type again replaces its pattern.
   void add_fsm(const std::string_view token_name, const std::string_view pattern);
 
-  // Attempts to match an FSM to the current input
-  std::pair<bool, std::string_view> match_fsm(const std::string_view input);
+  // Attempts to match an FSM to the start of input, returns the length of the longest match
+  // and the name of the FSM that matched, or 0 if none matches
+  std::pair<std::size_t, std::string_view> match_fsm(const std::string_view input);
 
 protected:
-  // Overrides the base class method to handle tokens using FSMs
-  virtual void handle_token(char c, std::vector<Token>& tokens) override;
+  void evaluate(Scratch& scratch) override;
+
+  bool step(Scratch& scratch) override;
+
+  // Overrides the base class method to handle tokens using FSMs, c is the character at the current index
+  virtual void handle_token(char c, TokenStream& tokens) override;
 
 private:
-  phmap::flat_hash_map<std::string_view, FSM> fsm_map;
+  // Merges the FSMs into _dfa if one was added since the last call
+  void compile();
+
+  std::vector<FSM> fsms;
+  phmap::flat_hash_map<std::string_view, std::size_t> fsm_map;
+
+  dfa::Dfa _dfa;
+  bool _compiled = false;
 };
 
 
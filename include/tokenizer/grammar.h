@@ -0,0 +1,235 @@
+#pragma once
+
+#include <string_view>
+
+#include "../common.h"
+#include "./perfect_hash.h"
+#include "./scan.h"
+#include "./static_tokenizer.h"
+#include "./table_tokenizer.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief Token rules of the Mara language, see examples/syntax.ra
+ *
+ */
+namespace grammar {
+
+// Keywords and operators by spelling, the same kinds the rules below produce for them
+inline constexpr PerfectHash<TokenKind, 11> keywords({{
+        {"as", TokenKind::decl_keyword},
+        {"::", TokenKind::decl_keyword},
+        {"return", TokenKind::return_keyword},
+        {"mutable", TokenKind::mutable_keyword},
+        {":", TokenKind::colon},
+        {"=", TokenKind::assign},
+        {"!", TokenKind::bang},
+        {"?", TokenKind::question},
+        {"(", TokenKind::paren_open},
+        {")", TokenKind::paren_close},
+        {",", TokenKind::comma},
+}}, TokenKind::none);
+
+// The kind of a keyword or operator, TokenKind::none for anything else, e.g. an identifier
+constexpr TokenKind keywordKind(std::string_view text) {
+    return keywords.find(text);
+}
+
+inline bool isWordChar(char c) {
+    return scan::isWord(c);
+}
+
+// Returns true if word is at index and is not part of a longer word
+inline bool isWordAt(std::string_view program, std::size_t index, std::string_view word) {
+    if (index > 0 && isWordChar(program[index - 1])) {
+        return false;
+    }
+
+    if (!program.substr(index).starts_with(word)) {
+        return false;
+    }
+
+    auto end = index + word.size();
+    return end >= program.size() || !isWordChar(program[end]);
+}
+
+inline bool isKeywordAt(std::string_view program, std::size_t index) {
+    return isWordAt(program, index, "as") || isWordAt(program, index, "return") ||
+           isWordAt(program, index, "mutable");
+}
+
+// Literals and names
+
+struct QuotedString : StaticRule {
+    static constexpr std::string_view name = "quoted string";
+    static constexpr std::string_view symbol = "\"";
+    static constexpr std::string_view terminator = "\"";
+    static constexpr TokenKind kind = TokenKind::string;
+    static constexpr bool opaque = true;
+};
+
+struct Identifier : StaticRule {
+    static constexpr std::string_view name = "identifier";
+    static constexpr TokenKind kind = TokenKind::identifier;
+    static constexpr scan::CharClass run = scan::CharClass::word;
+
+    static bool match(char c, std::size_t index, std::string_view program) {
+        if (!scan::isAlpha(c) && c != '_') {
+            return false;
+        }
+
+        // only the first character of a word opens the rule
+        if (index > 0 && isWordChar(program[index - 1])) {
+            return false;
+        }
+
+        return !isKeywordAt(program, index);
+    }
+};
+
+struct Number : StaticRule {
+    static constexpr std::string_view name = "number";
+    static constexpr TokenKind kind = TokenKind::number;
+    static constexpr scan::CharClass run = scan::CharClass::digit;
+
+    static bool match(char c, std::size_t index, std::string_view program) {
+        if (!scan::isDigit(c)) {
+            return false;
+        }
+
+        return index == 0 || !isWordChar(program[index - 1]);
+    }
+};
+
+// Keywords
+
+struct DeclOp : StaticRule {
+    static constexpr std::string_view name = "declaration";
+    static constexpr std::string_view symbol = "::";
+    static constexpr TokenKind kind = TokenKind::decl_keyword;
+};
+
+struct As : StaticRule {
+    static constexpr std::string_view name = "as";
+    static constexpr std::string_view symbol = "as";
+    static constexpr TokenKind kind = TokenKind::decl_keyword;
+
+    static bool match(char, std::size_t index, std::string_view program) {
+        return isWordAt(program, index, symbol);
+    }
+};
+
+struct Return : StaticRule {
+    static constexpr std::string_view name = "return";
+    static constexpr std::string_view symbol = "return";
+    static constexpr TokenKind kind = TokenKind::return_keyword;
+
+    static bool match(char, std::size_t index, std::string_view program) {
+        return isWordAt(program, index, symbol);
+    }
+};
+
+struct Mutable : StaticRule {
+    static constexpr std::string_view name = "mutable";
+    static constexpr std::string_view symbol = "mutable";
+    static constexpr TokenKind kind = TokenKind::mutable_keyword;
+
+    static bool match(char, std::size_t index, std::string_view program) {
+        return isWordAt(program, index, symbol);
+    }
+};
+
+// Punctuation
+
+struct Colon : StaticRule {
+    static constexpr std::string_view name = "colon";
+    static constexpr std::string_view symbol = ":";
+    static constexpr TokenKind kind = TokenKind::colon;
+};
+
+struct Assign : StaticRule {
+    static constexpr std::string_view name = "assign";
+    static constexpr std::string_view symbol = "=";
+    static constexpr TokenKind kind = TokenKind::assign;
+};
+
+struct Bang : StaticRule {
+    static constexpr std::string_view name = "bang";
+    static constexpr std::string_view symbol = "!";
+    static constexpr TokenKind kind = TokenKind::bang;
+};
+
+struct Question : StaticRule {
+    static constexpr std::string_view name = "question";
+    static constexpr std::string_view symbol = "?";
+    static constexpr TokenKind kind = TokenKind::question;
+};
+
+struct ParenOpen : StaticRule {
+    static constexpr std::string_view name = "paren open";
+    static constexpr std::string_view symbol = "(";
+    static constexpr TokenKind kind = TokenKind::paren_open;
+};
+
+struct ParenClose : StaticRule {
+    static constexpr std::string_view name = "paren close";
+    static constexpr std::string_view symbol = ")";
+    static constexpr TokenKind kind = TokenKind::paren_close;
+};
+
+struct Comma : StaticRule {
+    static constexpr std::string_view name = "comma";
+    static constexpr std::string_view symbol = ",";
+    static constexpr TokenKind kind = TokenKind::comma;
+};
+
+// "::" has to come before ":" since the first fixed rule that matches wins
+using MaraRules = StaticTokenizer<
+        QuotedString, DeclOp, As, Return, Mutable, Identifier, Number,
+        Colon, Assign, Bang, Question, ParenOpen, ParenClose, Comma
+>;
+
+/**
+ * @brief Function bodies are indented, so the Mara tokenizer emits indent and dedent tokens
+ */
+class MaraTokenizer : public MaraRules {
+public:
+    MaraTokenizer(std::string_view program) : MaraRules(program) { setLayout(true); }
+
+    MaraTokenizer(PaddedView program) : MaraRules(program) { setLayout(true); }
+};
+
+/**
+ * @brief The same tokens as patterns for TableTokenizer, comments and whitespace are skipped.
+ *        There are no indent and dedent tokens, the table has no layout.
+ */
+struct MaraPatterns {
+    static constexpr std::array tokens = {
+            TokenPattern{R"([ \t\r\n]+)"},
+            TokenPattern{R"(--[^\n]*)"},
+            TokenPattern{R"(!-([^-]|-+[^-!])*-+!)"},
+            TokenPattern{R"("[^"]*")", TokenKind::string},
+            TokenPattern{"::", TokenKind::decl_keyword},
+            TokenPattern{"as", TokenKind::decl_keyword},
+            TokenPattern{"return", TokenKind::return_keyword},
+            TokenPattern{"mutable", TokenKind::mutable_keyword},
+            TokenPattern{R"([a-zA-Z_]\w*)", TokenKind::identifier},
+            TokenPattern{R"(\d+(\.\d+)?)", TokenKind::number},
+            TokenPattern{":", TokenKind::colon},
+            TokenPattern{"=", TokenKind::assign},
+            TokenPattern{"!", TokenKind::bang},
+            TokenPattern{R"(\?)", TokenKind::question},
+            TokenPattern{R"(\()", TokenKind::paren_open},
+            TokenPattern{R"(\))", TokenKind::paren_close},
+            TokenPattern{",", TokenKind::comma},
+    };
+};
+
+using MaraTableTokenizer = TableTokenizer<MaraPatterns>;
+
+}  // namespace grammar
+
+}  // namespace lexer
+NAMESPACE_END
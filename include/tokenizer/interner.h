@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "../common.h"
+#include "../thread_pool.h"
+#include "./token.h"
+#include "./token_stream.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief Stores every distinct identifier once and names it with a NameId, so later phases compare
+ *        names with one integer compare instead of comparing strings. The text is copied into an
+ *        arena and looked up in a flat hash map keyed on views into it. A key keeps the hash of its
+ *        text, so the text is hashed once per lookup and never again when the map grows.
+ *
+ *        An Interner made with the default constructor isn't thread safe. One made by concurrent()
+ *        spreads the names over shards by hash, each with its own lock, arena and map, so threads
+ *        interning different names rarely wait on each other. Ids are stable and texts stay valid
+ *        as long as the interner, in both modes.
+ */
+class Interner {
+public:
+    // Shards of a concurrent interner if none are asked for
+    static constexpr std::size_t default_shards = 16;
+
+    Interner();
+
+    // A thread safe interner, shards is rounded up to a power of two of at most 256
+    static Interner concurrent(std::size_t shards = default_shards);
+
+    Interner(Interner &&other) noexcept;
+
+    Interner &operator=(Interner &&other) noexcept;
+
+    ~Interner();
+
+    // The id of text, text is added if it's new. Throws std::length_error if the ids run out.
+    NameId intern(std::string_view text);
+
+    // The id of text, no_name if it was never interned
+    [[nodiscard]] NameId find(std::string_view text) const;
+
+    // The text of id, which has to come from this interner
+    [[nodiscard]] std::string_view text(NameId id) const;
+
+    // Number of distinct names
+    [[nodiscard]] std::size_t size() const;
+
+    [[nodiscard]] bool isConcurrent() const { return _concurrent; }
+
+    // Interns the identifiers of tokens and gives them their ids, program is the text they were
+    // tokenized from. The name of an identifier is the run of word bytes its span starts with,
+    // tokens of other kinds keep no_name.
+    void intern(std::string_view program, TokenStream &tokens);
+
+    // The same with the tokens split over the workers of pool if the interner is concurrent, e.g.
+    // for the tokens of tokenizeParallel. Must not be called from a task running on pool.
+    void intern(std::string_view program, TokenStream &tokens, ThreadPool &pool);
+
+private:
+    struct Shard;
+
+    Interner(std::size_t shards, bool concurrent);
+
+    // Interns the identifiers of tokens [begin, end) into names
+    void internRange(std::string_view program, const TokenStream &tokens, std::span<NameId> names,
+                     std::size_t begin, std::size_t end);
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+
+    // log2 of the number of shards, the low bits of an id (minus one) are its shard
+    unsigned _shard_bits = 0;
+    bool _concurrent = false;
+};
+
+}  // namespace lexer
+NAMESPACE_END
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "../common.h"
+#include "./token.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief Offsets of the line starts of a program, built in one pass over its newlines.
+ *        Resolves byte offsets to 1-based lines and columns with a binary search, so the
+ *        tokenizer only has to keep offsets. A newline belongs to the line it ends.
+ */
+class LineIndex {
+public:
+    struct Position {
+        std::uint64_t line = 0;
+        std::uint64_t column = 0;
+    };
+
+    LineIndex() = default;
+
+    explicit LineIndex(std::string_view program);
+
+    [[nodiscard]] Position resolve(SourceOffset offset) const;
+
+    // Location of the first and the last byte of span
+    [[nodiscard]] CodeLocation resolve(SourceSpan span) const;
+
+    [[nodiscard]] std::size_t lines() const { return _line_starts.size(); }
+
+private:
+    std::vector<SourceOffset> _line_starts;
+};
+
+}  // namespace lexer
+NAMESPACE_END
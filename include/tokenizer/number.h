@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "../common.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief The value of a number literal, decoded while lexing so later phases never parse it again.
+ */
+struct Number {
+    enum class Type : std::uint8_t {
+        // digits only, e.g. 12
+        integer,
+        // digits with a fraction, e.g. 12.5
+        real,
+    };
+
+    Type type = Type::integer;
+
+    // the literal doesn't fit, integer is then the largest int64 and real is infinity
+    bool overflow = false;
+
+    std::int64_t integer = 0;
+    double real = 0;
+
+    bool operator==(const Number &other) const = default;
+};
+
+/**
+ * @brief Decodes the number literal at the start of text, digits with an optional fraction. Whatever
+ *        follows it is ignored, e.g. the terminator a rule's span ends with. Integers are read eight
+ *        digits at a time with SWAR. Reals are rounded correctly: exact doubles take Clinger's fast
+ *        path, the rest the Eisel-Lemire algorithm, and the rare case it can't decide falls back to
+ *        std::from_chars.
+ */
+Number decodeNumber(std::string_view text);
+
+}  // namespace lexer
+NAMESPACE_END
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "../common.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+// Zero bytes a padded buffer has after its text, one 64 byte vector load from the last byte
+// stays inside them
+inline constexpr std::size_t padding = 64;
+
+/**
+ * @brief A view of a program followed by at least padding zero bytes. Scanning kernels can load
+ *        whole vectors past the end and stop on the zeros, none of them are in a byte class.
+ */
+class PaddedView {
+public:
+    PaddedView() : _text(zeros, 0) {}
+
+    // The caller guarantees text is followed by padding zero bytes
+    static PaddedView assume(std::string_view text) { return PaddedView(text); }
+
+    [[nodiscard]] std::string_view text() const { return _text; }
+
+    [[nodiscard]] const char *data() const { return _text.data(); }
+
+    [[nodiscard]] std::size_t size() const { return _text.size(); }
+
+private:
+    explicit PaddedView(std::string_view text) : _text(text) {}
+
+    static constexpr char zeros[padding] = {};
+
+    std::string_view _text;
+};
+
+/**
+ * @brief An owned copy of a program with its padding.
+ */
+class PaddedString {
+public:
+    PaddedString() : PaddedString(std::string_view{}) {}
+
+    explicit PaddedString(std::string_view text) : _buffer(text.size() + padding, '\0'), _size(text.size()) {
+        text.copy(_buffer.data(), text.size());
+    }
+
+    // Takes over text, it's only copied if it has no room for the padding
+    explicit PaddedString(std::string &&text) : _buffer(std::move(text)), _size(_buffer.size()) {
+        _buffer.resize(_size + padding, '\0');
+    }
+
+    [[nodiscard]] PaddedView view() const { return PaddedView::assume({_buffer.data(), _size}); }
+
+    [[nodiscard]] std::string_view text() const { return {_buffer.data(), _size}; }
+
+    [[nodiscard]] std::size_t size() const { return _size; }
+
+private:
+    std::string _buffer;
+    std::size_t _size = 0;
+};
+
+}  // namespace lexer
+NAMESPACE_END
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <future>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "../common.h"
+#include "../thread_pool.h"
+#include "./scan.h"
+#include "./tokenizer.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+// Bytes per chunk of tokenizeParallel, smaller programs are tokenized on one thread
+inline constexpr std::size_t parallel_chunk_size = 1 << 20;
+
+/**
+ * @brief The first line start at or after from that isn't indented or blank, the size of the
+ *        program if there is none. Top level lines are the likeliest to have no rule open.
+ */
+inline std::size_t chunkStart(std::string_view program, std::size_t from) {
+    if (from == 0) {
+        return 0;
+    }
+
+    for (auto i = scan::findByte(program, '\n', from - 1); i + 1 < program.size();
+         i = scan::findByte(program, '\n', i + 1)) {
+        if (!scan::isSpace(program[i + 1])) {
+            return i + 1;
+        }
+    }
+
+    return program.size();
+}
+
+/**
+ * @brief Tokenizes the program of tokenizer in chunks on pool, with a copy of tokenizer per chunk.
+ *        Every chunk but the first assumes no rule is open where it starts and runs on until a
+ *        restart point past its end. The merge checks that assumption by looking for the restart
+ *        point the previous chunk stopped at among the chunk's own, a chunk that started in a
+ *        string or a block comment never has it and is tokenized again from there on until it
+ *        lines up. The result is the same as tokenizing the whole program at once.
+ */
+template<std::derived_from<Tokenizer> T>
+Tokenizer::Section tokenizeParallel(const T &tokenizer, ThreadPool &pool,
+                                    std::size_t chunk_size = parallel_chunk_size) {
+    const auto program = tokenizer.program();
+    chunk_size = std::max<std::size_t>(chunk_size, 1);
+
+    std::vector<std::size_t> starts{0};
+    while (starts.back() < program.size()) {
+        starts.push_back(chunkStart(program, starts.back() + chunk_size));
+    }
+
+    std::vector<std::future<Tokenizer::Section>> chunks;
+    for (std::size_t i = 0; i + 1 < starts.size(); ++i) {
+        chunks.push_back(pool.submit([&tokenizer, begin = starts[i], end = starts[i + 1]] {
+            T chunk = tokenizer;
+            return chunk.tokenizeSection(begin, [end](const RestartPoint &point) { return point.offset >= end; });
+        }));
+    }
+
+    if (chunks.empty()) {
+        T whole = tokenizer;
+        return whole.tokenizeSection(0, [](const RestartPoint &) { return false; });
+    }
+
+    // Appends from after its restart point at index restart, or all of it if restart is npos
+    auto splice = [](Tokenizer::Section &merged, const Tokenizer::Section &from, std::size_t restart) {
+        auto point = restart == std::string_view::npos ? RestartPoint{from.begin} : from.restarts[restart];
+        const auto tokens = merged.tokens.size();
+        const auto docs = merged.docs.size();
+
+        merged.tokens.append(from.tokens, point.tokens);
+        merged.docs.insert(merged.docs.end(), from.docs.begin() + point.docs, from.docs.end());
+        for (auto &diagnostic: from.diagnostics) {
+            if (diagnostic.span.begin >= point.offset) {
+                merged.diagnostics.push_back(diagnostic);
+            }
+        }
+
+        auto first = restart == std::string_view::npos ? 0 : restart + 1;
+        for (auto i = first; i < from.restarts.size(); ++i) {
+            auto next = from.restarts[i];
+            // a section starts looking at its text where it begins, the lookahead before it carries over
+            const auto examined = merged.restarts.empty() ? next.examined
+                                                          : std::max(next.examined, merged.restarts.back().examined);
+            merged.restarts.push_back({next.offset, next.tokens - point.tokens + tokens, next.docs - point.docs + docs,
+                                       examined});
+        }
+
+        merged.end = from.end;
+    };
+
+    // Index of the restart point of section at offset, npos for its start, nullopt if there is none
+    auto lineUp = [](const Tokenizer::Section &section, SourceOffset offset) -> std::optional<std::size_t> {
+        if (offset == section.begin) {
+            return std::string_view::npos;
+        }
+
+        auto it = std::lower_bound(section.restarts.begin(), section.restarts.end(), offset,
+                                   [](const RestartPoint &point, SourceOffset value) { return point.offset < value; });
+        if (it == section.restarts.end() || it->offset != offset) {
+            return std::nullopt;
+        }
+        return static_cast<std::size_t>(it - section.restarts.begin());
+    };
+
+    // the tasks refer to tokenizer, none may be left running if merging throws
+    for (auto &chunk: chunks) {
+        chunk.wait();
+    }
+
+    // the first chunk starts at the start of the program, so it is always right
+    auto merged = chunks[0].get();
+
+    for (std::size_t i = 1; i < chunks.size(); ++i) {
+        auto section = chunks[i].get();
+
+        while (merged.end < section.end) {
+            if (auto restart = lineUp(section, merged.end)) {
+                splice(merged, section, *restart);
+                break;
+            }
+
+            // the chunk started inside something, tokenize on from where the merged part ends
+            T relexer = tokenizer;
+            auto relexed = relexer.tokenizeSection(merged.end, [&](const RestartPoint &point) {
+                return point.offset >= section.end || lineUp(section, point.offset).has_value();
+            });
+            splice(merged, relexed, std::string_view::npos);
+        }
+    }
+
+    return merged;
+}
+
+}  // namespace lexer
+NAMESPACE_END
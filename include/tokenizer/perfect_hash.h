@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+#include "../common.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief A minimal perfect hash from keys to values, built at compile time. The N keys go to N slots
+ *        with one hash of a key's length, first byte and last byte, like gperf does, the seed that
+ *        makes it collision free is searched for when the table is built. A lookup hashes the text,
+ *        probes one slot and compares the text with its key, there's no loop over the text.
+ *
+ * @code
+ * constexpr PerfectHash<TokenKind, 2> kinds({{{"as", TokenKind::decl_keyword}, {"::", TokenKind::decl_keyword}}},
+ *                                           TokenKind::none);
+ * @endcode
+ */
+template<class Value, std::size_t N>
+class PerfectHash {
+public:
+    struct Entry {
+        std::string_view key;
+        Value value;
+    };
+
+    // Doesn't compile if a key is empty, two keys have the same length, first and last byte or no
+    // seed is found
+    consteval PerfectHash(const std::array<Entry, N> &entries, Value missing) : _missing(missing) {
+        for (std::size_t i = 0; i < N; ++i) {
+            if (entries[i].key.empty()) {
+                throw std::invalid_argument("perfect hash keys can't be empty");
+            }
+            for (std::size_t j = 0; j < i; ++j) {
+                if (signature(entries[i].key) == signature(entries[j].key)) {
+                    throw std::invalid_argument("perfect hash keys need different lengths, first or last bytes");
+                }
+            }
+        }
+
+        for (std::uint64_t seed = 1; seed < max_seed; ++seed) {
+            std::array<bool, N> taken{};
+            bool collided = false;
+
+            for (auto &entry: entries) {
+                auto slot = slotOf(signature(entry.key), seed);
+                if (taken[slot]) {
+                    collided = true;
+                    break;
+                }
+                taken[slot] = true;
+            }
+
+            if (collided) {
+                continue;
+            }
+
+            _seed = seed;
+            for (auto &entry: entries) {
+                _slots[slotOf(signature(entry.key), seed)] = {entry.key, entry.value};
+            }
+            return;
+        }
+
+        throw std::invalid_argument("no perfect hash seed found");
+    }
+
+    // The value of text, the missing value if it isn't a key
+    [[nodiscard]] constexpr Value find(std::string_view text) const {
+        if (text.empty()) {
+            return _missing;
+        }
+
+        const auto &slot = _slots[slotOf(signature(text), _seed)];
+        return slot.key == text ? slot.value : _missing;
+    }
+
+    [[nodiscard]] constexpr std::uint64_t seed() const { return _seed; }
+
+private:
+    // a random function is a bijection with probability N!/N^N, about 1 in 7000 for 11 keys
+    static constexpr std::uint64_t max_seed = 1 << 20;
+
+    struct Slot {
+        std::string_view key;
+        Value value{};
+    };
+
+    // The first byte, the last byte and the length of text, which isn't empty
+    static constexpr std::uint64_t signature(std::string_view text) {
+        return static_cast<std::uint64_t>(static_cast<unsigned char>(text.front())) |
+               static_cast<std::uint64_t>(static_cast<unsigned char>(text.back())) << 8 |
+               static_cast<std::uint64_t>(text.size()) << 16;
+    }
+
+    static constexpr std::size_t slotOf(std::uint64_t signature, std::uint64_t seed) {
+        // the signature only has 24 bits, one multiply mixes them into the high half
+        const auto x = (signature ^ seed) * 0x9E3779B97F4A7C15ull;
+
+        // the high 32 bits scaled to [0, N), no division
+        return static_cast<std::size_t>(((x >> 32) * N) >> 32);
+    }
+
+    std::array<Slot, N> _slots{};
+    std::uint64_t _seed = 0;
+    Value _missing;
+};
+
+}  // namespace lexer
+NAMESPACE_END
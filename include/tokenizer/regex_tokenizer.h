@@ -4,27 +4,61 @@
 
 #pragma once
 
-#include <regex>
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
 
+#include "./dfa.h"
 #include "./tokenizer.h"
 
 NAMESPACE_BEGIN
 namespace lexer {
 
+/**
+ * @brief A tokenizer for a fixed set of regular expressions. The patterns are compiled once into
+ *        one DFA that every RegexTokenizer shares, each lexeme is matched in a single pass over
+ *        its bytes. The longest match wins, the pattern listed first wins ties, so "as" is a
+ *        keyword and "ask" an identifier.
+ */
 class RegexTokenizer : public Tokenizer {
 public:
+  // The patterns in order of priority, a value is an index into patterns
+  enum class Pattern : std::int8_t {
+    none = -1,
+    keyword,
+    identifier,
+    number,
+    whitespace,
+  };
+
   explicit RegexTokenizer(const std::string_view program);
 
+  explicit RegexTokenizer(PaddedView program);
+
+  // The longest match of any pattern at the start of input and the pattern that matched,
+  // a length of 0 and Pattern::none if nothing matches
+  static std::pair<std::size_t, Pattern> match(std::string_view input);
+
 protected:
-  // Override handle_token to use regular expressions for tokenizing
-  virtual void handle_token(char c, std::vector<Token>& tokens) override;
+  void evaluate(Scratch& scratch) override;
+
+  bool step(Scratch& scratch) override;
+
+  // Matches the lexeme at the current index, c is its first character
+  virtual void handle_token(char c, TokenStream& tokens) override;
 
 private:
-  // Define your regular expressions for different tokens here
-  std::regex keyword_regex{R"((decl_keyword|return_keyword))"};
-  std::regex identifier_regex{R"([a-zA-Z_][a-zA-Z0-9_]*)"};
-  std::regex number_regex{R"(\d+(\.\d+)?)"};
-  // Add more regular expressions for other token types as needed
+  // see dfa.h for the syntax
+  static constexpr std::array<std::string_view, 4> patterns = {
+      R"(::|:|=|!|\?|\(|\)|,|as|return|mutable)",
+      R"([a-zA-Z_][a-zA-Z0-9_]*)",
+      R"(\d+(\.\d+)?)",
+      R"(\s+)",
+  };
+
+  // The DFA of all patterns, built the first time any RegexTokenizer needs it
+  static const dfa::Dfa& combined();
 };
 
 
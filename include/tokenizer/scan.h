@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "../common.h"
+#include "./padded.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief Byte classification for the tokenizer. Unlike <cctype> this doesn't depend on the
+ *        locale, bytes >= 0x80 are never in a class.
+ */
+namespace scan {
+
+enum class CharClass : std::uint8_t {
+    none = 0,
+
+    // [A-Za-z]
+    alpha = 1 << 0,
+    // [0-9]
+    digit = 1 << 1,
+    // [A-Za-z0-9_]
+    word = 1 << 2,
+    // [ \t\n\v\f\r]
+    space = 1 << 3,
+};
+
+DEFINE_ENUM_FLAGS(CharClass)
+
+inline constexpr std::array<std::uint8_t, 256> char_classes = [] {
+    std::array<std::uint8_t, 256> table{};
+
+    auto add = [&](unsigned lo, unsigned hi, CharClass cls) {
+        for (auto c = lo; c <= hi; ++c) {
+            table[c] |= static_cast<std::uint8_t>(cls);
+        }
+    };
+
+    add('a', 'z', CharClass::alpha);
+    add('A', 'Z', CharClass::alpha);
+    add('0', '9', CharClass::digit);
+
+    add('a', 'z', CharClass::word);
+    add('A', 'Z', CharClass::word);
+    add('0', '9', CharClass::word);
+    add('_', '_', CharClass::word);
+
+    add('\t', '\r', CharClass::space);
+    add(' ', ' ', CharClass::space);
+
+    return table;
+}();
+
+constexpr bool is(char c, CharClass cls) {
+    return char_classes[static_cast<unsigned char>(c)] & static_cast<std::uint8_t>(cls);
+}
+
+constexpr bool isAlpha(char c) { return is(c, CharClass::alpha); }
+
+constexpr bool isDigit(char c) { return is(c, CharClass::digit); }
+
+constexpr bool isWord(char c) { return is(c, CharClass::word); }
+
+constexpr bool isSpace(char c) { return is(c, CharClass::space); }
+
+/**
+ * @brief Returns how many bytes at the start of data are in cls, cls is one of alpha, digit,
+ *        word or space. Checks 32 bytes at a time with AVX2, 16 with SSE2 and 8 otherwise.
+ */
+std::size_t run(CharClass cls, const char *data, std::size_t size);
+
+inline std::size_t wordRun(std::string_view text) { return run(CharClass::word, text.data(), text.size()); }
+
+inline std::size_t digitRun(std::string_view text) { return run(CharClass::digit, text.data(), text.size()); }
+
+inline std::size_t spaceRun(std::string_view text) { return run(CharClass::space, text.data(), text.size()); }
+
+/**
+ * @brief Like run() for text followed by padding zeros (see padded.h) from data on. Whole vectors
+ *        are loaded until one has a byte outside cls, the zeros end every run so there are no
+ *        bounds checks and no tail loop.
+ */
+std::size_t paddedRun(CharClass cls, const char *data);
+
+// Index of the first c at or after from, text.size() if there is none
+std::size_t findByte(std::string_view text, char c, std::size_t from = 0);
+
+/**
+ * @brief Index of the first a directly followed by b at or after from, text.size() if there is none.
+ *        Checks a vector of pairs at a time like run().
+ */
+std::size_t findPair(std::string_view text, char a, char b, std::size_t from = 0);
+
+// findPair() for padded text, a can't be zero. Loads vectors up to the end without a tail loop.
+std::size_t findPair(PaddedView text, char a, char b, std::size_t from = 0);
+
+}  // namespace scan
+
+}  // namespace lexer
+NAMESPACE_END
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../common.h"
+#include "./tokenizer.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief Defaults for a rule type used with StaticTokenizer. A rule type derives from this and
+ *        shadows what it needs, at least a name and either a symbol or a match function.
+ *
+ * @code
+ * struct QuotedString : StaticRule {
+ *     static constexpr std::string_view name = "quoted string";
+ *     static constexpr std::string_view symbol = "\"";
+ *     static constexpr std::string_view terminator = "\"";
+ *     static constexpr TokenKind kind = TokenKind::string;
+ * };
+ * @endcode
+ */
+struct StaticRule {
+    static constexpr std::string_view symbol = "";
+    static constexpr std::string_view terminator = "";
+
+    static constexpr TokenDirection direction = TokenDirection::RIGHT;
+
+    static constexpr TokenKind kind = TokenKind::none;
+
+    static constexpr bool opaque = false;
+
+    static constexpr scan::CharClass run = scan::CharClass::none;
+
+    // Same as TokenRule::matcher, called only when the first byte of symbol matched
+    static constexpr bool match(char, std::size_t, std::string_view) { return true; }
+};
+
+template<typename R>
+concept StaticRuleType = requires(char c, std::size_t index, std::string_view program) {
+    { R::name } -> std::convertible_to<std::string_view>;
+    { R::symbol } -> std::convertible_to<std::string_view>;
+    { R::terminator } -> std::convertible_to<std::string_view>;
+    { R::direction } -> std::convertible_to<TokenDirection>;
+    { R::kind } -> std::convertible_to<TokenKind>;
+    { R::opaque } -> std::convertible_to<bool>;
+    { R::run } -> std::convertible_to<scan::CharClass>;
+    { R::match(c, index, program) } -> std::convertible_to<bool>;
+};
+
+/**
+ * @brief A rule set known at compile time, the counterpart of RuleSet.
+ *        Rule ids are the positions of the rules in the pack.
+ *
+ * @tparam Rules rule types, see StaticRule
+ */
+template<StaticRuleType... Rules>
+struct StaticRuleSet {
+
+    static constexpr std::array<RuleInfo, sizeof...(Rules)> infos = {
+        RuleInfo{Rules::name, Rules::symbol, Rules::terminator, Rules::direction, Rules::kind, Rules::opaque,
+                 Rules::run}...
+    };
+
+    [[nodiscard]] static constexpr RuleInfo info(RuleId id) { return infos[id]; }
+
+    [[nodiscard]] static constexpr std::size_t size() { return sizeof...(Rules); }
+
+    // Writes the ids of the rules that can start on c into rules, in pack order
+    static void candidates(char c, std::size_t index, std::string_view &program, std::vector<RuleId> &rules) {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (candidate<Rules, I>(c, index, program, rules), ...);
+        }(std::index_sequence_for<Rules...>{});
+    }
+
+private:
+    template<class R, std::size_t I>
+    static void candidate(char c, std::size_t index, std::string_view program, std::vector<RuleId> &rules) {
+        if constexpr (!R::symbol.empty()) {
+            if (c != R::symbol[0]) {
+                return;
+            }
+        }
+
+        if (R::match(c, index, program)) {
+            rules.push_back(static_cast<RuleId>(I));
+        }
+    }
+};
+
+/**
+ * @brief A tokenizer with its rules fixed at compile time. Matchers are called directly instead of
+ *        through std::function, so the whole loop can be inlined. Behaves the same as a Tokenizer
+ *        with the same rules registered in the same order.
+ *
+ *        Rules can't be added with registerRule, use a Tokenizer while prototyping rules.
+ *
+ * @tparam Rules rule types, see StaticRule
+ */
+template<StaticRuleType... Rules>
+class StaticTokenizer : public Tokenizer {
+public:
+    using Tokenizer::Tokenizer;
+
+protected:
+    void evaluate(Scratch &scratch) override {
+        evaluateRules(_static_rules, scratch);
+    }
+
+    bool step(Scratch &scratch) override {
+        return stepRules(_static_rules, scratch);
+    }
+
+    [[nodiscard]] RuleInfo ruleInfo(RuleId id) const override {
+        return _static_rules.info(id);
+    }
+
+private:
+    StaticRuleSet<Rules...> _static_rules;
+};
+
+}  // namespace lexer
+NAMESPACE_END
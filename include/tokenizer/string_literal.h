@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "../common.h"
+#include "./arena.h"
+#include "./token_stream.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * String literals are tokens with a span like any other, their text stays in the program. While
+ * lexing, a string token is only checked for a backslash, with one vector scan. Escapes are decoded
+ * when something asks for the value, and a literal without backslashes is never decoded or copied.
+ *
+ * The escapes are \n, \t, \r, \0, \\, \' and \". Any other backslash is kept as written. A quote
+ * ends a literal, so \" only shows up in literals of rules with another terminator.
+ */
+
+// The text between the quotes of a literal, a missing closing quote is fine
+std::string_view stringBody(std::string_view literal);
+
+// A backslash is somewhere in text
+bool hasEscapes(std::string_view text);
+
+// The value of body, body itself if it has no escapes, otherwise decoded into arena
+std::string_view unescape(std::string_view body, Arena &arena);
+
+// Appends the value of body to out
+void unescape(std::string_view body, std::string &out);
+
+// The value of the string token at index of tokens, body decoding is skipped if lexing saw no backslash
+std::string_view stringValue(const TokenStream &tokens, std::size_t index, std::string_view program, Arena &arena);
+
+}  // namespace lexer
+NAMESPACE_END
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+#include "../common.h"
+#include "./dfa.h"
+#include "./tokenizer.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief A token pattern for TableTokenizer. Text matched by a pattern with TokenKind::none
+ *        is skipped, e.g. whitespace and comments.
+ */
+struct TokenPattern {
+    std::string_view pattern;
+    TokenKind kind = TokenKind::none;
+};
+
+/**
+ * @brief A tokenizer driven by a DFA that is built from Grammar::tokens at compile time.
+ *        The table lives in read-only memory and scanning is one table lookup per byte,
+ *        the longest match wins and earlier patterns win ties.
+ *
+ * @tparam Grammar has a static constexpr std::array<TokenPattern, N> tokens
+ */
+template<class Grammar>
+class TableTokenizer : public Tokenizer {
+
+    struct Patterns {
+        static constexpr auto patterns = [] {
+            std::array<std::string_view, Grammar::tokens.size()> patterns{};
+            for (std::size_t i = 0; i < patterns.size(); ++i) {
+                patterns[i] = Grammar::tokens[i].pattern;
+            }
+            return patterns;
+        }();
+    };
+
+public:
+    using Tokenizer::Tokenizer;
+
+    static constexpr auto table = dfa::compileTable<Patterns>();
+
+protected:
+    void evaluate(Scratch &scratch) override {
+        while (TableTokenizer::step(scratch)) {}
+    }
+
+    bool step(Scratch &) override {
+        if (_current_index >= _program_size) {
+            return false;
+        }
+
+        auto match = dfa::munch(table.view(), _program, _current_index);
+        examine(_current_index + match.examined);
+
+        // the match could go on in the next chunk of a streamed program
+        if (_stream_open && match.more) {
+            return false;
+        }
+
+        // nothing starts with this byte, skip it
+        if (match.length == 0) {
+            _current_index++;
+            markRestart();
+            return true;
+        }
+
+        auto kind = Grammar::tokens[match.pattern].kind;
+        if (kind != TokenKind::none) {
+            auto span = SourceSpan{offsetAt(_current_index), offsetAt(_current_index + match.length)};
+            pushToken(_tokens, kind, span);
+        }
+
+        _current_index += match.length;
+        markRestart();
+        return true;
+    }
+};
+
+}  // namespace lexer
+NAMESPACE_END
@@ -4,10 +4,13 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <format>
 #include <parallel_hashmap/phmap_utils.h>
 #include <string>
 #include <string_view>
+#include <utility>
 
 #include "../common.h"
 #include "../logger.h"
@@ -131,11 +134,96 @@ enum class ExpressionType {
 
 DEFINE_ENUM_FLAGS(ExpressionType)
 
+/**
+ * @brief The kind of token a tokenizer rule produces. Unlike Symbol and IdentifierType these
+ *        are not flags, each kind maps to one combination of them (see symbolOf and identifierTypeOf).
+ */
+enum class TokenKind : std::uint8_t {
+    none = 0,
+
+    identifier,
+    string,
+    number,
+
+    // :: or as
+    decl_keyword,
+    return_keyword,
+    mutable_keyword,
+
+    // : = ! ? ( ) ,
+    colon,
+    assign,
+    bang,
+    question,
+    paren_open,
+    paren_close,
+    comma,
+
+    // the indentation of a line went up or back down, see Tokenizer::setLayout
+    indent,
+    dedent,
+};
+
+constexpr Symbol symbolOf(TokenKind kind) {
+    switch (kind) {
+        case TokenKind::decl_keyword:
+            return Symbol::decl_keyword;
+        case TokenKind::return_keyword:
+            return Symbol::return_keyword;
+        default:
+            return Symbol::none;
+    }
+}
+
+constexpr IdentifierType identifierTypeOf(TokenKind kind) {
+    switch (kind) {
+        case TokenKind::none:
+            return IdentifierType::none;
+        case TokenKind::identifier:
+            return IdentifierType::identifier;
+        case TokenKind::string:
+        case TokenKind::number:
+            return IdentifierType::literal;
+        default:
+            return IdentifierType::token;
+    }
+}
+
+/**
+ * @brief The kind spelled like name, e.g. "identifier" or "decl_keyword". TokenKind::none if there is none.
+ */
+constexpr TokenKind kindOf(std::string_view name) {
+    constexpr std::array<std::pair<std::string_view, TokenKind>, 15> kinds = {{
+            {"identifier", TokenKind::identifier},
+            {"string", TokenKind::string},
+            {"number", TokenKind::number},
+            {"decl_keyword", TokenKind::decl_keyword},
+            {"return_keyword", TokenKind::return_keyword},
+            {"mutable_keyword", TokenKind::mutable_keyword},
+            {"colon", TokenKind::colon},
+            {"assign", TokenKind::assign},
+            {"bang", TokenKind::bang},
+            {"question", TokenKind::question},
+            {"paren_open", TokenKind::paren_open},
+            {"paren_close", TokenKind::paren_close},
+            {"comma", TokenKind::comma},
+            {"indent", TokenKind::indent},
+            {"dedent", TokenKind::dedent},
+    }};
+
+    for (const auto &[kind_name, kind]: kinds) {
+        if (kind_name == name) {
+            return kind;
+        }
+    }
+    return TokenKind::none;
+}
+
 struct CodeLocation {
-    unsigned int line_start = 0;  // line number of the token
-    unsigned int column_start = 0;  // column number of the token
-    unsigned int line_end = 0;  // line number of the token
-    unsigned int column_end = 0;  // column number of the token
+    std::uint64_t line_start = 0;  // line number of the token
+    std::uint64_t column_start = 0;  // column number of the token
+    std::uint64_t line_end = 0;  // line number of the token
+    std::uint64_t column_end = 0;  // column number of the token
 
     [[nodiscard]] std::string toString() const {
         return std::format("({}:{})-({}:{})", line_start, column_start, line_end, column_end);
@@ -174,14 +262,57 @@ struct CodeLocation {
 };
 
 
+// Byte offset into the program, 64 bits so programs over 4 GiB work
+using SourceOffset = std::uint64_t;
+
+// An identifier interned by an Interner, see interner.h
+using NameId = std::uint32_t;
+
+// The name of a token that isn't an identifier or wasn't interned
+inline constexpr NameId no_name = 0;
+
+/**
+ * @brief The bytes [begin, end) of the program. Line and column are resolved on demand
+ *        with a LineIndex, see line_index.h.
+ */
+struct SourceSpan {
+    SourceOffset begin = 0;
+    SourceOffset end = 0;
+
+    [[nodiscard]] SourceOffset size() const { return end - begin; }
+
+    // The text of the span in program, a view into it
+    [[nodiscard]] std::string_view text(std::string_view program) const { return program.substr(begin, size()); }
+
+    bool operator==(const SourceSpan &rhs) const = default;
+
+    friend size_t hash_value(const SourceSpan &t) {
+        return phmap::HashState().combine(0, t.begin, t.end);
+    }
+};
+
 struct Token {
 
-    CodeLocation location;
+    SourceSpan span;
 
     Symbol symbol = Symbol::none;
     IdentifierType identifier_type = IdentifierType::none;
     ExpressionType expression_type = ExpressionType::none;
 
+    TokenKind kind = TokenKind::none;
+
+    /**
+     * @brief Creates the token a rule of the given kind produces
+     */
+    static Token fromKind(TokenKind kind, SourceSpan span) {
+        Token token;
+        token.span = span;
+        token.symbol = symbolOf(kind);
+        token.identifier_type = identifierTypeOf(kind);
+        token.kind = kind;
+        return token;
+    }
+
     /**
      * @brief Returns true if the token is valid
      *
@@ -194,9 +325,9 @@ struct Token {
             return false;
         }
 
-        // check if code loc is valid
-        if (!location) {
-            logger::error("Invalid token: code location is invalid");
+        // check if the span is valid
+        if (span.begin > span.end) {
+            logger::error("Invalid token: span is invalid");
             return false;
         }
 
@@ -211,12 +342,13 @@ struct Token {
      */
     [[nodiscard]]
     bool isStart() const {
-        return location.line_start == 0 && location.column_start == 0 && location.line_end == 0 && location.column_end == 0;
+        return span.begin == 0 && span.end == 0;
     }
 
     bool operator==(const Token &other) const {
-        return location == other.location && symbol == other.symbol &&
-               identifier_type == other.identifier_type && expression_type == other.expression_type;
+        return span == other.span && symbol == other.symbol &&
+               identifier_type == other.identifier_type && expression_type == other.expression_type &&
+               kind == other.kind;
     };
 
     /**
@@ -227,7 +359,7 @@ struct Token {
      */
     friend size_t hash_value(const Token &t) {
         return phmap::HashState().combine(
-                0, t.location, t.symbol, t.identifier_type, t.expression_type
+                0, t.span, t.symbol, t.identifier_type, t.expression_type, t.kind
         );
     }
 };
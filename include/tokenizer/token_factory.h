@@ -15,9 +15,11 @@ namespace lexer {
 
 class TokenFactory {
 public:
-  // Creates a token with the given symbol, identifier type, and expression type
+  // Creates a token with the given symbol, identifier type, and expression type. symbol is spelled like in
+  // a program, e.g. "as" or "::", the types are named like their enum values, e.g. "literal" or "declaration".
+  // Each is looked up with one hash in a perfect hash table, see perfect_hash.h
   static Token create_token(std::string_view symbol, std::string_view identifier_type, std::string_view expression_type,
-                            unsigned int line, unsigned int column);
+                            SourceSpan span);
 
 private:
   // Helper methods to convert string_view to Symbol, IdentifierType, and ExpressionType
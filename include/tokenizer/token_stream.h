@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "../common.h"
+#include "./number.h"
+#include "./token.h"
+
+NAMESPACE_BEGIN
+namespace lexer {
+
+/**
+ * @brief One token of a TokenStream. Symbol and identifier type follow from the kind,
+ *        see symbolOf and identifierTypeOf.
+ */
+struct TokenView {
+    TokenKind kind = TokenKind::none;
+    SourceSpan span;
+
+    // set once the stream went through Interner::intern
+    NameId name = no_name;
+
+    // the decoded value of a number token, see TokenStream::number
+    std::optional<Number> number;
+
+    // a string token with escapes to decode, see TokenStream::escaped
+    bool escaped = false;
+
+    [[nodiscard]] Symbol symbol() const { return symbolOf(kind); }
+
+    [[nodiscard]] IdentifierType identifierType() const { return identifierTypeOf(kind); }
+
+    // The same token as a Token, which has no name
+    [[nodiscard]] Token token() const { return Token::fromKind(kind, span); }
+
+    bool operator==(const TokenView &other) const = default;
+};
+
+/**
+ * @brief Tokens stored as parallel arrays of kinds, offsets and lengths, 13 bytes per token.
+ *        Offsets are 64 bits, lengths 32, pushing a token of 4 GiB or more throws std::length_error.
+ *        A parser scanning kinds only touches the kinds array. The names array is empty
+ *        until a name is set, a stream that isn't interned doesn't pay for it. Decoded
+ *        numbers are kept apart with the indexes of their tokens, most tokens aren't numbers.
+ *        The same goes for the string tokens with a backslash, see string_literal.h.
+ */
+class TokenStream {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = TokenView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = TokenView;
+
+        iterator() = default;
+
+        iterator(const TokenStream *stream, std::size_t index) : _stream(stream), _index(index) {}
+
+        TokenView operator*() const { return (*_stream)[_index]; }
+
+        TokenView operator[](difference_type n) const { return (*_stream)[_index + n]; }
+
+        iterator &operator++() {
+            ++_index;
+            return *this;
+        }
+
+        iterator operator++(int) {
+            auto copy = *this;
+            ++_index;
+            return copy;
+        }
+
+        iterator &operator--() {
+            --_index;
+            return *this;
+        }
+
+        iterator operator--(int) {
+            auto copy = *this;
+            --_index;
+            return copy;
+        }
+
+        iterator &operator+=(difference_type n) {
+            _index += n;
+            return *this;
+        }
+
+        iterator &operator-=(difference_type n) {
+            _index -= n;
+            return *this;
+        }
+
+        friend iterator operator+(iterator it, difference_type n) { return it += n; }
+
+        friend iterator operator+(difference_type n, iterator it) { return it += n; }
+
+        friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+
+        friend difference_type operator-(const iterator &a, const iterator &b) {
+            return static_cast<difference_type>(a._index) - static_cast<difference_type>(b._index);
+        }
+
+        bool operator==(const iterator &other) const { return _index == other._index; }
+
+        auto operator<=>(const iterator &other) const { return _index <=> other._index; }
+
+    private:
+        const TokenStream *_stream = nullptr;
+        std::size_t _index = 0;
+    };
+
+    [[nodiscard]] std::size_t size() const { return _kinds.size(); }
+
+    [[nodiscard]] bool empty() const { return _kinds.empty(); }
+
+    void reserve(std::size_t size) {
+        _kinds.reserve(size);
+        _offsets.reserve(size);
+        _lengths.reserve(size);
+    }
+
+    void clear() {
+        _kinds.clear();
+        _offsets.clear();
+        _lengths.clear();
+        _names.clear();
+        _numbers.clear();
+        _number_tokens.clear();
+        _escaped_tokens.clear();
+    }
+
+    void push(TokenKind kind, SourceSpan span, NameId name = no_name) {
+        if (span.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error("a token can't be longer than 4 GiB");
+        }
+
+        _kinds.push_back(kind);
+        _offsets.push_back(span.begin);
+        _lengths.push_back(static_cast<std::uint32_t>(span.size()));
+
+        if (!_names.empty() || name != no_name) {
+            _names.resize(_kinds.size() - 1, no_name);
+            _names.push_back(name);
+        }
+    }
+
+    // A token of another stream, with its name, value and escapes
+    void push(const TokenView &token) {
+        push(token.kind, token.span, token.name);
+        if (token.number) {
+            _numbers.push_back(*token.number);
+            _number_tokens.push_back(_kinds.size() - 1);
+        }
+        if (token.escaped) {
+            _escaped_tokens.push_back(_kinds.size() - 1);
+        }
+    }
+
+    // Only the kind and span of token are kept
+    void push_back(const Token &token) { push(token.kind, token.span); }
+
+    // A number token with its decoded value
+    void pushNumber(SourceSpan span, const Number &number) {
+        push(TokenKind::number, span);
+        _numbers.push_back(number);
+        _number_tokens.push_back(_kinds.size() - 1);
+    }
+
+    // A string token, escaped if its text has a backslash
+    void pushString(SourceSpan span, bool escaped) {
+        push(TokenKind::string, span);
+        if (escaped) {
+            _escaped_tokens.push_back(_kinds.size() - 1);
+        }
+    }
+
+    // Appends the tokens of other from index from on
+    void append(const TokenStream &other, std::size_t from = 0) { append(other, from, other.size(), 0); }
+
+    // Appends the tokens [from, to) of other with their offsets moved by shift
+    void append(const TokenStream &other, std::size_t from, std::size_t to, std::int64_t shift) {
+        const auto size = _kinds.size();
+
+        _kinds.insert(_kinds.end(), other._kinds.begin() + from, other._kinds.begin() + to);
+        _offsets.insert(_offsets.end(), other._offsets.begin() + from, other._offsets.begin() + to);
+        _lengths.insert(_lengths.end(), other._lengths.begin() + from, other._lengths.begin() + to);
+
+        if (shift != 0) {
+            for (auto i = size; i < _offsets.size(); ++i) {
+                _offsets[i] = static_cast<SourceOffset>(static_cast<std::int64_t>(_offsets[i]) + shift);
+            }
+        }
+
+        if (!other._names.empty()) {
+            _names.resize(size, no_name);
+            _names.insert(_names.end(), other._names.begin() + from, other._names.begin() + to);
+        } else if (!_names.empty()) {
+            _names.resize(_kinds.size(), no_name);
+        }
+
+        auto first = std::lower_bound(other._number_tokens.begin(), other._number_tokens.end(), from);
+        for (auto it = first; it != other._number_tokens.end() && *it < to; ++it) {
+            _numbers.push_back(other._numbers[it - other._number_tokens.begin()]);
+            _number_tokens.push_back(*it - from + size);
+        }
+
+        auto escaped = std::lower_bound(other._escaped_tokens.begin(), other._escaped_tokens.end(), from);
+        for (auto it = escaped; it != other._escaped_tokens.end() && *it < to; ++it) {
+            _escaped_tokens.push_back(*it - from + size);
+        }
+    }
+
+    [[nodiscard]] TokenView operator[](std::size_t index) const {
+        TokenView token{_kinds[index], {_offsets[index], _offsets[index] + _lengths[index]}, name(index)};
+
+        // only numbers and strings look up their payload
+        if (token.kind == TokenKind::number) {
+            token.number = number(index);
+        } else if (token.kind == TokenKind::string) {
+            token.escaped = escaped(index);
+        }
+        return token;
+    }
+
+    [[nodiscard]] NameId name(std::size_t index) const { return _names.empty() ? no_name : _names[index]; }
+
+    // The decoded value of a number token, nothing for other tokens
+    [[nodiscard]] std::optional<Number> number(std::size_t index) const {
+        auto it = std::lower_bound(_number_tokens.begin(), _number_tokens.end(), index);
+        if (it == _number_tokens.end() || *it != index) {
+            return std::nullopt;
+        }
+        return _numbers[it - _number_tokens.begin()];
+    }
+
+    // Decoded numbers in token order
+    [[nodiscard]] std::span<const Number> numbers() const { return _numbers; }
+
+    // The string token at index has escapes to decode, see stringValue
+    [[nodiscard]] bool escaped(std::size_t index) const {
+        return std::binary_search(_escaped_tokens.begin(), _escaped_tokens.end(), index);
+    }
+
+
+    [[nodiscard]] TokenView back() const { return (*this)[size() - 1]; }
+
+    [[nodiscard]] TokenKind kind(std::size_t index) const { return _kinds[index]; }
+
+    [[nodiscard]] std::span<const TokenKind> kinds() const { return _kinds; }
+
+    [[nodiscard]] std::span<const SourceOffset> offsets() const { return _offsets; }
+
+    [[nodiscard]] std::span<const std::uint32_t> lengths() const { return _lengths; }
+
+    // Empty if no token has a name
+    [[nodiscard]] std::span<const NameId> names() const { return _names; }
+
+    // The names array sized to the stream, for setting many names at once, e.g. from several threads
+    std::span<NameId> nameSlots() {
+        _names.resize(_kinds.size(), no_name);
+        return _names;
+    }
+
+    [[nodiscard]] iterator begin() const { return {this, 0}; }
+
+    [[nodiscard]] iterator end() const { return {this, size()}; }
+
+    // A stream without names equals one whose names are all no_name. Number values and escaped
+    // strings always count, push a TokenView to keep them when copying tokens one by one.
+    bool operator==(const TokenStream &other) const {
+        if (_kinds != other._kinds || _offsets != other._offsets || _lengths != other._lengths) {
+            return false;
+        }
+
+        if (_numbers != other._numbers || _number_tokens != other._number_tokens ||
+            _escaped_tokens != other._escaped_tokens) {
+            return false;
+        }
+
+        if (_names.empty() || other._names.empty()) {
+            auto &names = _names.empty() ? other._names : _names;
+            return std::all_of(names.begin(), names.end(), [](NameId name) { return name == no_name; });
+        }
+
+        return _names == other._names;
+    }
+
+private:
+    std::vector<TokenKind> _kinds;
+    std::vector<SourceOffset> _offsets;
+    std::vector<std::uint32_t> _lengths;
+    std::vector<NameId> _names;
+
+    // values of the number tokens and their indexes, in token order
+    std::vector<Number> _numbers;
+    std::vector<std::size_t> _number_tokens;
+
+    // indexes of the string tokens with a backslash
+    std::vector<std::size_t> _escaped_tokens;
+};
+
+}  // namespace lexer
+NAMESPACE_END
@@ -6,15 +6,29 @@
 
 
 #include <parallel_hashmap/phmap_utils.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
 #include <string_view>
 #include <vector>
 #include <stack>
 #include <string>
 #include <memory>
 #include <functional>
+#include <span>
+#include <optional>
+#include <stdexcept>
 
 #include "../common.h"
+#include "../error.h"
+#include "../logger.h"
+#include "./line_index.h"
+#include "./padded.h"
+#include "./scan.h"
+#include "./string_literal.h"
 #include "./token.h"
+#include "./token_stream.h"
 
 NAMESPACE_BEGIN
 namespace lexer {
@@ -28,6 +42,41 @@ enum class TokenDirection {
     RIGHT,
 };
 
+// Index of a registered rule in the tokenizer, assigned by Tokenizer::registerRule
+using RuleId = std::uint32_t;
+
+/**
+ * @brief The parts of a rule the tokenizer loop needs. Both TokenRule and the static rule types
+ *        (see static_tokenizer.h) are described by one of these.
+ *
+ * A rule with a terminator is opened on its symbol and closed on the first byte of its terminator.
+ * A rule without a terminator is a fixed token that matches its whole symbol, like "::". If it has a run
+ * class its token goes on over the bytes of that class after its symbol, or after the byte it opened on if
+ * it has no symbol, and ends before the first byte outside the run, like an identifier.
+ * Rules with a kind other than TokenKind::none produce a token when they are closed.
+ * No other rule is opened while an opaque rule is on top of the stack, e.g. inside a quoted string.
+ * The bytes up to the first byte of its terminator are skipped at once with a vector scan.
+ * While a rule with a terminator and a run class is on top of the stack, the bytes of that class after
+ * the current one are skipped at once. The rule promises they can't terminate it or open another rule.
+ * A LEFT rule reaches back from its symbol to the last byte before it that starts its terminator, it's
+ * closed as soon as it's opened and produces nothing if there is no such byte. The tokenizer only keeps
+ * the last offset of those bytes, so it never moves backwards. Sections and retokenize() only look back
+ * to where they started.
+ */
+struct RuleInfo {
+    std::string_view name;
+    std::string_view symbol;
+    std::string_view terminator;
+
+    TokenDirection direction = TokenDirection::RIGHT;
+
+    TokenKind kind = TokenKind::none;
+
+    bool opaque = false;
+
+    scan::CharClass run = scan::CharClass::none;
+};
+
 struct TokenRule {
     friend class Tokenizer;
 
@@ -37,20 +86,133 @@ struct TokenRule {
 
     TokenDirection direction = TokenDirection::RIGHT;
 
-    CodeLocation location = {0, 0, 0, 0};
+    SourceSpan span;
+
+    std::function<bool(char, std::size_t, std::string_view &)> matcher = nullptr;
+
+    TokenKind kind = TokenKind::none;
+
+    bool opaque = false;
 
-    std::function<bool(char, unsigned long, std::string_view &)> matcher = nullptr;
+    scan::CharClass run = scan::CharClass::none;
 
-    TokenRule clone(CodeLocation location) {
+    TokenRule clone(SourceSpan span) const {
         TokenRule rule;
         rule.name = name;
         rule.symbol = symbol;
         rule.terminator = terminator;
         rule.direction = direction;
-        rule.location = location;
+        rule.span = span;
+        rule.kind = kind;
+        rule.opaque = opaque;
+        rule.run = run;
+        rule.id = id;
         return rule;
     }
 
+    static TokenRule fromInfo(const RuleInfo &info, RuleId id, SourceSpan span) {
+        TokenRule rule;
+        rule.name = info.name;
+        rule.symbol = info.symbol;
+        rule.terminator = info.terminator;
+        rule.direction = info.direction;
+        rule.span = span;
+        rule.kind = info.kind;
+        rule.opaque = info.opaque;
+        rule.run = info.run;
+        rule.id = id;
+        return rule;
+    }
+
+    [[nodiscard]] RuleInfo info() const {
+        return {name, symbol, terminator, direction, kind, opaque, run};
+    }
+
+    RuleId id = 0;
+
+};
+
+/**
+ * @brief An open rule on the tokenizer stack. Refers back to its TokenRule by id,
+ *        so pushing and popping never copies names or matchers.
+ */
+struct RuleFrame {
+    RuleId rule = 0;
+    SourceSpan span;
+
+#ifdef ENV_TEST
+    // index into Tokenizer::_rule_history
+    std::size_t history = 0;
+#endif
+};
+
+/**
+ * @brief A comment directly under a function header, text points into the program and doesn't
+ *        include the comment markers. span covers the whole comment.
+ */
+struct DocComment {
+    std::string_view text;
+    SourceSpan span;
+};
+
+struct LexErrorCode : BaseErrorCode<> {
+    inline static Error<LexErrorCode> number_overflow = {1 << 1, "Number literal doesn't fit in 64 bits"};
+};
+
+using LexError = Error<LexErrorCode>;
+
+/**
+ * @brief An error found while lexing, span covers the text it is about. Lexing goes on past it.
+ */
+struct Diagnostic {
+    LexError error;
+    SourceSpan span;
+};
+
+/**
+ * @brief Replaces removed bytes at offset with inserted, offset is in the program before the edit.
+ */
+struct TextEdit {
+    SourceOffset offset = 0;
+    SourceOffset removed = 0;
+    std::string_view inserted;
+};
+
+/**
+ * @brief A line start the tokenizer passed with nothing open, tokenizing can restart there.
+ *        tokens and docs are how many tokens and doc comments came before it. examined is one
+ *        past the furthest byte tokenizing up to it looked at, lookahead can go past the point.
+ *        An edit at or after examined doesn't change anything before the point.
+ */
+struct RestartPoint {
+    SourceOffset offset = 0;
+    std::size_t tokens = 0;
+    std::size_t docs = 0;
+    SourceOffset examined = 0;
+};
+
+/**
+ * @brief Rules registered at runtime through Tokenizer::registerRule.
+ *
+ */
+class RuleSet {
+public:
+    RuleId add(TokenRule &rule);
+
+    [[nodiscard]] RuleInfo info(RuleId id) const { return _rules[id].info(); }
+
+    [[nodiscard]] std::size_t size() const { return _rules.size(); }
+
+    // Writes the ids of the rules that can start on c into rules, in registration order
+    void candidates(char c, std::size_t index, std::string_view &program, std::vector<RuleId> &rules) const;
+
+private:
+    std::vector<TokenRule> _rules;
+
+    // ids of rules keyed on the first byte of TokenRule::symbol
+    std::array<std::vector<RuleId>, 256> _rules_by_char;
+    // ids of rules with an empty symbol, these are candidates for every byte
+    std::vector<RuleId> _wildcard_rules;
 };
 
 /**
@@ -59,68 +221,358 @@ struct TokenRule {
  */
 class Tokenizer {
 public:
+    /**
+     * @brief Buffers used by the per-character loop. They are cleared, never shrunk, so once
+     *        they have grown to fit the rule set a tokenize pass does not allocate.
+     */
+    struct Scratch {
+        // rules that can start on the current character
+        std::vector<RuleId> candidates;
+        // rules on the stack that ended on the current character
+        std::vector<RuleFrame> terminated;
+        // storage the next pass writes its tokens into, a stream that is no longer needed can be moved back here
+        TokenStream tokens;
+    };
+
+    /**
+     * @brief Part of a program from begin up to a restart point at end, or the end of the program.
+     *        The token and doc counts of the restart points start at begin.
+     */
+    struct Section {
+        SourceOffset begin = 0;
+        SourceOffset end = 0;
+
+        TokenStream tokens;
+        std::vector<DocComment> docs;
+        std::vector<RestartPoint> restarts;
+        std::vector<Diagnostic> diagnostics;
+    };
+
     Tokenizer(std::string_view program);
 
-    // Tokenizes the input program and returns a vector of tokens
-    std::vector<Token> tokenize();
+    // Tokenizes a padded program, its scans rely on the zeros after it instead of bounds checks
+    Tokenizer(PaddedView program);
+
+    virtual ~Tokenizer() = default;
+
+    // Tokenizes the input program and returns its tokens, the stream is moved out of the tokenizer
+    TokenStream tokenize();
+
+    // Same as tokenize(), but with caller-owned scratch buffers that can be reused between calls.
+    // The tokens are written into scratch.tokens, so a pass whose buffers have grown doesn't allocate.
+    TokenStream tokenize(Scratch &scratch);
 
     void registerRule(TokenRule &rule);
 
+    /**
+     * @brief Turns on indent and dedent tokens for the rule loop. After a line break that isn't inside
+     *        an opaque rule, the blank lines, comment-only lines and leading spaces up to the next line
+     *        with code are skipped without stepping the rules, so no rule may open on a space. If the
+     *        line is indented deeper than the top of the indentation stack an indent covering its
+     *        leading spaces is pushed, a dedent is emitted at the code for every level it's indented
+     *        less than. Indentation is counted in bytes, a tab is one. The levels still open at the
+     *        end of the program get their dedents there.
+     */
+    void setLayout(bool layout) { _layout = layout; }
+
+    // How far peek() can look ahead
+    static constexpr std::size_t lookahead = 8;
+
+    // Pull interface, tokens are produced as they are asked for and in the same order as tokenize().
+    // The first call starts at the beginning of the program, tokenize() abandons a pull in progress.
+    // Returns the next token with its number value or escapes, or nothing once the program is done.
+    std::optional<TokenView> next();
+
+    // Returns the token k places after the next one without consuming anything, k < lookahead.
+    // Throws std::out_of_range if k is too far ahead.
+    std::optional<TokenView> peek(std::size_t k = 0);
+
+    /**
+     * @brief Tokenizes program, the program of the last tokenize call with edit applied, reusing
+     *        previous, the tokens that call returned. Only the lines from the last restart point
+     *        before the edit up to where the tokens line up with previous again are tokenized,
+     *        tokens after that are previous shifted by the edit. The tokenizer reads program from
+     *        then on. Throws std::invalid_argument if previous doesn't fit the last tokenize call.
+     *        Tokens taken from previous keep their names, the new ones have none until interned.
+     */
+    TokenStream retokenize(std::string_view program, const TokenStream &previous, const TextEdit &edit);
+
+    TokenStream retokenize(PaddedView program, const TokenStream &previous, const TextEdit &edit);
+
+    /**
+     * @brief Tokenizes a program that arrives in chunks, e.g. over a pipe. feed() tokenizes as far as
+     *        the text so far allows and returns the tokens that ended in it, finish() ends the input
+     *        and returns the rest. The rule stack, a line still to be laid out and the open
+     *        indentation levels carry over from one chunk to the next, the tokens are the same
+     *        wherever the chunks split. Only the text of the rules still open and the few bytes the
+     *        next step looks at are kept, so memory is bounded by the chunk size and the longest
+     *        token rather than the program. Token offsets count from the start of the input. While
+     *        streaming program() is the kept text and no restart points are recorded. finish() puts
+     *        back the program the tokenizer was made with.
+     */
+    TokenStream feed(std::span<const char> chunk);
+
+    TokenStream finish();
+
+    /**
+     * @brief Tokenizes from begin, a line start where no rule is assumed to be open, until the first
+     *        restart point stop returns true for. Resets the tokenizer like tokenize().
+     */
+    template<class Stop>
+    Section tokenizeSection(std::size_t begin, Stop stop);
+
+    [[nodiscard]] std::string_view program() const { return _program; }
+
+    // Restart points found by the last tokenize call, in program order
+    [[nodiscard]] const std::vector<RestartPoint> &restartPoints() const { return _restarts; }
+
+    // Doc comments found by the last tokenize call, in program order
+    [[nodiscard]] const std::vector<DocComment> &docComments() const { return _doc_comments; }
+
+    // Errors found by the last tokenize call, in program order
+    [[nodiscard]] const std::vector<Diagnostic> &diagnostics() const { return _diagnostics; }
+
+    // Line starts of the program, built on the first call. Tokens only carry offsets,
+    // resolve them with this when a line and column are needed.
+    const LineIndex &lines();
+
 
 protected:
     void handle_start();
 
-    void evaluate();
+    // Pushes a token to tokens, a number token with its decoded value and a string token with
+    // whether it has escapes
+    void pushToken(TokenStream &tokens, TokenKind kind, SourceSpan span) {
+        if (kind == TokenKind::number) {
+            pushNumber(tokens, span);
+        } else if (kind == TokenKind::string) {
+            tokens.pushString(span, hasEscapes(_program.substr(span.begin - _base, span.size())));
+        } else {
+            tokens.push(kind, span);
+        }
+    }
+
+    // Decodes the number at span, a number that doesn't fit is reported in _diagnostics
+    void pushNumber(TokenStream &tokens, SourceSpan span);
+
+    // Runs the whole program, the same as calling step() until it returns false
+    virtual void evaluate(Scratch &scratch);
+
+    // Moves on by at least one position, pushing the tokens that end there to _tokens.
+    // Returns false once the program is done.
+    virtual bool step(Scratch &scratch);
+
+    // Describes a rule of this tokenizer, only used for logging and debugging
+    [[nodiscard]] virtual RuleInfo ruleInfo(RuleId id) const;
+
+    /**
+     * @brief The tokenizer loop. Rules is either RuleSet or a StaticRuleSet, it has to provide
+     *        info(RuleId), size() and candidates(c, index, program, out).
+     */
+    template<class Rules>
+    void evaluateRules(const Rules &rules, Scratch &scratch);
+
+    // One character of the tokenizer loop, false once the program is done
+    template<class Rules>
+    bool stepRules(const Rules &rules, Scratch &scratch);
+
+    template<class Rules>
+    void pushRule(const Rules &rules, RuleId id);
 
-    void pushRule(std::shared_ptr<TokenRule> rule);
+    template<class Rules>
+    void applyRule(const Rules &rules, const RuleFrame &frame);
 
-    void applyRule(TokenRule &&rule);
+    // Emits a fixed rule if its whole symbol and the run after it are at the current index, returns the
+    // length matched
+    template<class Rules>
+    std::size_t applyFixedRule(const Rules &rules, RuleId id);
 
-    std::vector<std::shared_ptr<TokenRule>> getRulesForChar(char c);
+    // Moves past the bytes of class run at the current index
+    void skipRun(scan::CharClass run);
 
-    std::vector<TokenRule> terminateStackRules(char c);
+    // Moves on to the next c, or the end of the program if there is none
+    void skipUntil(char c);
+
+    // Length of the run of class run at index
+    [[nodiscard]] std::size_t runAt(scan::CharClass run, std::size_t index) const;
+
+    /**
+     * @brief Skips from the line start at the current index to the next line with code and emits its
+     *        indent or dedents, see setLayout. Rules that the skipped spaces would close are closed.
+     *        Returns false without moving if a streamed program doesn't have the rest of it yet.
+     */
+    template<class Rules>
+    bool layoutLine(const Rules &rules, Scratch &scratch);
+
+    // Emits a dedent for every indentation level still open
+    void closeIndents();
+
+    // Offset in the input of an index into _program
+    [[nodiscard]] SourceOffset offsetAt(std::size_t index) const {
+        return static_cast<SourceOffset>(_base + index);
+    }
+
+    // Looks through rules for what the loop needs to know about them, once per tokenize call
+    template<class Rules>
+    void prepare(const Rules &rules);
+
+    // Records the last offsets of the LEFT terminator bytes between from and to
+    void trackLeft(std::size_t from, std::size_t to);
+
+    // Records a restart point if the current index starts a line and no rule is open
+    void markRestart() {
+        if (_streaming || _current_index == 0 || _current_index >= _program_size || _program[_current_index - 1] != '\n') {
+            return;
+        }
+
+        if (!_rule_stack.empty() || !_indents.empty()) {
+            return;
+        }
+
+        if (_restarts.empty() || _restarts.back().offset < _current_index) {
+            _restarts.push_back({offsetAt(_current_index), _tokens.size(), _doc_comments.size(),
+                                 offsetAt(std::max(_examined, _current_index))});
+        }
+    }
+
+    // Records that the bytes before end were looked at, see RestartPoint::examined
+    void examine(std::size_t end) {
+        _examined = std::max(_examined, std::min(end, _program_size));
+    }
+
+
+    template<class Rules>
+    void getRulesForChar(const Rules &rules, char c, std::vector<RuleId> &candidates);
+
+    template<class Rules>
+    void terminateStackRules(const Rules &rules, char c, std::vector<RuleFrame> &terminated);
 
     // Handles whitespace characters
-    virtual void handle_whitespace(char c, std::vector<Token> &tokens);
+    virtual void handle_whitespace(char c, TokenStream &tokens);
 
-    // Checks if a comment starts at the current character
+    // Checks if a -- or !- comment starts at index
     virtual bool is_comment_start(char c, size_t index);
 
-    // Handles comments in the input program
+    // Finds the end of the comment at index and records it if it's a doc comment, returns the index
+    // after the comment. A -- comment ends before its newline, an unterminated !- comment at the end.
     virtual size_t handle_comments(size_t index);
 
     // Handles token characters in the input program
-    virtual void handle_token(char c, std::vector<Token> &tokens);
+    virtual void handle_token(char c, TokenStream &tokens);
 
 
 protected:
     Token _current_token;
 
-private:
     std::string_view _program;
-    std::vector<Token> _tokens;
-    std::vector<std::shared_ptr<TokenRule>> _rules;
+    TokenStream _tokens;
+    std::size_t _program_size = 0;
+
+    std::vector<DocComment> _doc_comments;
+    std::vector<RestartPoint> _restarts;
+    std::vector<Diagnostic> _diagnostics;
+
+    std::size_t _current_index = 0;
+
+    // one past the furthest index any step looked at
+    std::size_t _examined = 0;
+
+    // offset of _program in the input, only not 0 while streaming
+    SourceOffset _base = 0;
+
+    // more chunks of a streamed program can follow, see feed()
+    bool _stream_open = false;
+
+private:
+    // True if the comment at index is the first thing under a line ending in ')'
+    [[nodiscard]] bool isDocPosition(size_t index) const;
+
+    RuleSet _rules;
 
-    std::stack<TokenRule> _rule_stack;
+    std::vector<RuleFrame> _rule_stack;
+    Scratch _scratch;
 
-    TokenDirection _current_direction = TokenDirection::RIGHT;
+    // set by prepare()
+    bool _prepared = false;
 
-    unsigned long _current_line = 0;
-    unsigned long _current_column = 0;
-    unsigned long _prev_line_column = 0;
+    // bytes a step of the rules can look at from the current index, the longest symbol and the byte after it
+    std::size_t _step_length = 0;
 
-    unsigned long _current_index = 0;
-    unsigned long _program_size = 0;
+    // indent and dedent tokens are emitted, see setLayout
+    bool _layout = false;
+    // the next step lays out the line at the current index
+    bool _layout_pending = false;
+    // widths of the indentation levels that are open, the outermost first
+    std::vector<std::size_t> _indents;
+
+    // first bytes of the terminators of LEFT rules and one past the offset each was last seen at, 0 if not yet
+    std::vector<unsigned char> _left_bytes;
+    std::array<SourceOffset, 256> _last_seen{};
+
+    // Moves tokens from the last step into the lookahead until it holds count of them,
+    // returns false if the program ended first
+    bool fill(std::size_t count);
+
+    // Ring buffer of the pulled tokens that haven't been consumed yet
+    std::array<TokenView, lookahead> _ahead;
+    std::size_t _ahead_head = 0;
+    std::size_t _ahead_count = 0;
+
+    // Tokens of the last step already moved to _ahead
+    std::size_t _emitted = 0;
+    bool _pulling = false;
+    bool _pull_done = false;
+
+    LineIndex _lines;
+    bool _lines_built = false;
+
+    // the program is followed by padding zeros, see padded.h
+    bool _padded = false;
+
+    TokenStream retokenize(std::string_view program, bool padded, const TokenStream &previous, const TextEdit &edit);
+
+    // Starts streaming, the program the tokenizer was made with is put aside until finish()
+    void startStream();
+
+    // Drops the text no step will look at again
+    void compactStream();
+
+    // Steps as far as the streamed text allows and moves out the tokens
+    TokenStream drainStream();
+
+    bool _streaming = false;
+
+    // the kept text of a streamed program, _program views it
+    std::string _stream;
+
+    // run classes of the fixed rules, a streamed run can go on in the next chunk
+    std::vector<scan::CharClass> _fixed_runs;
+
+    // True if a run of a fixed rule at the current index reaches the end of the streamed text so far
+    [[nodiscard]] bool streamedRunOpen() const;
+
+    // doc comment texts of the stream, _stream doesn't keep them
+    std::deque<std::string> _stream_docs;
+
+    std::string_view _unstreamed;
+    bool _unstreamed_padded = false;
 
 
 #ifdef ENV_TEST
     public:
 
     std::stack<TokenRule> debugRuleStack() {
-        auto rule_stack = std::stack(_rule_stack);
+        std::stack<TokenRule> rule_stack;
+        for (auto &frame: _rule_stack) {
+            rule_stack.push(TokenRule::fromInfo(ruleInfo(frame.rule), frame.rule, frame.span));
+        }
         return std::move(rule_stack);
     };
 
+    // set to false to keep the history and trace logging out of the loop
+    bool _debug_history = true;
+
+    std::deque<TokenRule> _rule_history;
     std::vector<TokenRule*> _rule_stack_history;
     std::vector<char> _char_history;
 
@@ -128,6 +580,395 @@ private:
 
 };
 
+template<class Stop>
+Tokenizer::Section Tokenizer::tokenizeSection(std::size_t begin, Stop stop) {
+    handle_start();
+    _current_index = begin;
+    _examined = begin;
+
+    Section section;
+    section.begin = static_cast<SourceOffset>(begin);
+    section.end = static_cast<SourceOffset>(_program_size);
+
+    auto seen = _restarts.size();
+    while (step(_scratch)) {
+        if (_restarts.size() == seen) {
+            continue;
+        }
+        seen = _restarts.size();
+
+        if (stop(_restarts.back())) {
+            section.end = _restarts.back().offset;
+            break;
+        }
+    }
+
+    section.tokens = std::move(_tokens);
+    section.docs = std::move(_doc_comments);
+    section.restarts = std::move(_restarts);
+    section.diagnostics = std::move(_diagnostics);
+    return section;
+}
+
+// Tokenizer loop
+// -----------------------------------------------------------------------------
+
+template<class Rules>
+void Tokenizer::evaluateRules(const Rules &rules, Scratch &scratch) {
+    // a character can never have more candidates than there are rules
+    scratch.candidates.reserve(rules.size());
+
+    while (stepRules(rules, scratch)) {}
+}
+
+template<class Rules>
+bool Tokenizer::stepRules(const Rules &rules, Scratch &scratch) {
+    if (_current_index >= _program_size) {
+        if (!_indents.empty() && !_stream_open) {
+            closeIndents();
+        }
+        return false;
+    }
+
+    if (!_prepared) {
+        prepare(rules);
+    }
+
+    // the rules could look at bytes of a streamed program that haven't arrived yet
+    if (_stream_open && (_program_size - _current_index < _step_length || streamedRunOpen())) {
+        return false;
+    }
+
+    if (_layout_pending) {
+        return layoutLine(rules, scratch);
+    }
+
+    const auto index = _current_index;
+    const char c = _program[index];
+
+    // comments never reach the rules, except inside an opaque rule like a string
+    if ((c == '-' || c == '!') && (_rule_stack.empty() || !rules.info(_rule_stack.back().rule).opaque) &&
+        is_comment_start(c, _current_index)) {
+        const auto docs = _doc_comments.size();
+        const auto end = handle_comments(_current_index);
+
+        // the end of the comment hasn't arrived yet, it's looked for again with the next chunk
+        if (_stream_open && end >= _program_size) {
+            _doc_comments.resize(docs);
+            return false;
+        }
+
+        _current_index = end;
+        if (!_left_bytes.empty()) {
+            trackLeft(index, _current_index);
+        }
+        examine(_current_index + 1);
+        return true;
+    }
+
+#ifdef ENV_TEST
+    if (_debug_history) {
+        _char_history.push_back(c);
+
+        logger::trace("Current char: [{}]({})", c, _current_index);
+    }
+#endif
+
+    // check if any rule on stack terminates on this character
+    terminateStackRules(rules, c, scratch.terminated);
+
+    // apply terminated rules
+    for (auto &frame: scratch.terminated) {
+        applyRule(rules, frame);
+    }
+
+    // nothing opens inside an opaque rule
+    if (!_rule_stack.empty() && rules.info(_rule_stack.back().rule).opaque) {
+        scratch.candidates.clear();
+    } else {
+        getRulesForChar(rules, c, scratch.candidates);
+    }
+
+    std::size_t fixed_length = 0;
+
+    // add all rules that aren't terminated
+    for (auto id: scratch.candidates) {
+        if (rules.info(id).terminator.empty()) {
+            // only the first fixed rule that matches is applied
+            if (fixed_length == 0) {
+                fixed_length = applyFixedRule(rules, id);
+            }
+            continue;
+        }
+
+        auto terminated = std::any_of(scratch.terminated.begin(), scratch.terminated.end(),
+                                      [id](const RuleFrame &frame) {
+                                          return frame.rule == id;
+                                      });
+
+        if (!terminated) {
+            pushRule(rules, id);
+        }
+    }
+
+    _current_index++;
+
+    // the rest of a fixed token is not looked at again
+    if (fixed_length > 1) {
+        _current_index += fixed_length - 1;
+    }
+
+    // neither is the rest of a run, or the inside of an opaque rule up to its terminator
+    if (fixed_length == 0 && !_rule_stack.empty()) {
+        const auto top = rules.info(_rule_stack.back().rule);
+        if (top.opaque) {
+            skipUntil(top.terminator[0]);
+        } else {
+            skipRun(top.run);
+        }
+    }
+
+    if (!_left_bytes.empty()) {
+        trackLeft(index, _current_index);
+    }
+
+    // matchers look no further than the longest symbol and the byte after it, a run up to the byte after it
+    examine(std::max(index + _step_length, _current_index + 1));
+
+    if (c == '\n') {
+        // the next step lays out the new line, a restart point can only come after that
+        if (_layout && (_rule_stack.empty() || !rules.info(_rule_stack.back().rule).opaque)) {
+            _layout_pending = true;
+            return true;
+        }
+
+        markRestart();
+    }
+
+    return true;
+}
+
+template<class Rules>
+bool Tokenizer::layoutLine(const Rules &rules, Scratch &scratch) {
+    const auto start = _current_index;
+    const auto docs = _doc_comments.size();
+
+    // the first byte of the line being looked at that isn't a space
+    auto first = std::string_view::npos;
+    auto index = start;
+
+    while (true) {
+        const auto end = index + runAt(scan::CharClass::space, index);
+
+        // the loop would have stepped the spaces, rules that end on one still end there
+        for (auto i = index; i < end && !_rule_stack.empty(); ++i) {
+            _current_index = i;
+            terminateStackRules(rules, _program[i], scratch.terminated);
+            for (auto &frame: scratch.terminated) {
+                applyRule(rules, frame);
+            }
+        }
+
+        if (_program.substr(index, end - index).find('\n') != std::string_view::npos) {
+            first = std::string_view::npos;
+        }
+        index = end;
+
+        // a comment start needs the byte after it
+        if (_stream_open && index + 1 >= _program_size) {
+            _doc_comments.resize(docs);
+            _current_index = start;
+            return false;
+        }
+
+        // only blank lines are left, the dedents come at the end of the program
+        if (index >= _program_size) {
+            _current_index = index;
+            _layout_pending = false;
+            return true;
+        }
+
+        if (first == std::string_view::npos) {
+            first = index;
+        }
+
+        if (!is_comment_start(_program[index], index)) {
+            break;
+        }
+
+        index = handle_comments(index);
+        if (_stream_open && index >= _program_size) {
+            _doc_comments.resize(docs);
+            _current_index = start;
+            return false;
+        }
+    }
+
+    // the indentation is the spaces in front of first in the text, where the step before stopped
+    // and which rules were open don't change it. The text kept while streaming reaches back to the
+    // newline before them.
+    auto line = first;
+    while (line > 0 && _program[line - 1] != '\n' && scan::isSpace(_program[line - 1])) {
+        --line;
+    }
+    const auto width = first - line;
+
+    while (!_indents.empty() && _indents.back() > width) {
+        _indents.pop_back();
+        _tokens.push(TokenKind::dedent, {offsetAt(first), offsetAt(first)});
+    }
+
+    if (width > (_indents.empty() ? 0 : _indents.back())) {
+        _indents.push_back(width);
+        _tokens.push(TokenKind::indent, {offsetAt(line), offsetAt(first)});
+    }
+
+    _current_index = index;
+    _layout_pending = false;
+    examine(index + _step_length);
+    markRestart();
+    return true;
+}
+
+template<class Rules>
+void Tokenizer::prepare(const Rules &rules) {
+    // a comment start is two bytes
+    _step_length = 2;
+    _left_bytes.clear();
+    _fixed_runs.clear();
+
+    for (RuleId id = 0; id < rules.size(); ++id) {
+        const auto rule = rules.info(id);
+        _step_length = std::max(_step_length, rule.symbol.size() + 1);
+
+        if (rule.terminator.empty() && rule.run != scan::CharClass::none &&
+            std::find(_fixed_runs.begin(), _fixed_runs.end(), rule.run) == _fixed_runs.end()) {
+            _fixed_runs.push_back(rule.run);
+        }
+
+        if (rule.direction == TokenDirection::LEFT && !rule.terminator.empty()) {
+            auto byte = static_cast<unsigned char>(rule.terminator[0]);
+            if (std::find(_left_bytes.begin(), _left_bytes.end(), byte) == _left_bytes.end()) {
+                _left_bytes.push_back(byte);
+            }
+        }
+    }
+
+    _prepared = true;
+}
+
+template<class Rules>
+void Tokenizer::getRulesForChar(const Rules &rules, char c, std::vector<RuleId> &candidates) {
+    candidates.clear();
+    rules.candidates(c, _current_index, _program, candidates);
+}
+
+template<class Rules>
+void Tokenizer::terminateStackRules(const Rules &rules, char c, std::vector<RuleFrame> &terminated) {
+    terminated.clear();
+
+    while (!_rule_stack.empty()) {
+        auto frame = _rule_stack.back();
+        const auto rule = rules.info(frame.rule);
+
+        if (rule.terminator.empty() || rule.terminator[0] != c) {
+            break;
+        }
+
+        _rule_stack.pop_back();
+        frame.span.end = offsetAt(_current_index + 1);
+
+#ifdef ENV_TEST
+        if (_debug_history) {
+            _rule_history[frame.history].span = frame.span;
+        }
+#endif
+
+        terminated.push_back(frame);
+    }
+}
+
+template<class Rules>
+void Tokenizer::pushRule(const Rules &rules, RuleId id) {
+    const auto rule = rules.info(id);
+
+    RuleFrame frame;
+    frame.rule = id;
+    frame.span = {offsetAt(_current_index), 0};
+
+    // a LEFT rule already has its whole span, it's closed right away instead of going on the stack
+    SourceOffset seen = 0;
+    if (rule.direction == TokenDirection::LEFT) {
+        seen = _last_seen[static_cast<unsigned char>(rule.terminator[0])];
+        frame.span = {seen == 0 ? 0 : seen - 1, offsetAt(_current_index + 1)};
+    }
+
+#ifdef ENV_TEST
+    if (_debug_history) {
+        logger::debug("Pushing rule: {}", rule.name);
+
+        frame.history = _rule_history.size();
+        _rule_history.push_back(TokenRule::fromInfo(rule, id, frame.span));
+        _rule_stack_history.push_back(&_rule_history.back());
+    }
+#endif
+
+    if (rule.direction == TokenDirection::LEFT) {
+        if (seen != 0) {
+            applyRule(rules, frame);
+        }
+        return;
+    }
+
+    _rule_stack.push_back(frame);
+}
+
+template<class Rules>
+void Tokenizer::applyRule(const Rules &rules, const RuleFrame &frame) {
+    const auto rule = rules.info(frame.rule);
+
+#ifdef ENV_TEST
+    if (_debug_history) {
+        logger::debug("Applying rule: {}", rule.name);
+    }
+#endif
+
+    if (rule.kind != TokenKind::none) {
+        pushToken(_tokens, rule.kind, frame.span);
+    }
+}
+
+template<class Rules>
+std::size_t Tokenizer::applyFixedRule(const Rules &rules, RuleId id) {
+    const auto rule = rules.info(id);
+
+    if (!_program.substr(_current_index).starts_with(rule.symbol)) {
+        return 0;
+    }
+
+    auto length = rule.symbol.size();
+
+    // the candidate already matched the byte it opens on, the run goes on after it
+    if (rule.run != scan::CharClass::none) {
+        length = std::max<unsigned long>(length, 1);
+        const auto at = _current_index + length;
+        length += _padded ? scan::paddedRun(rule.run, _program.data() + at)
+                          : scan::run(rule.run, _program.data() + at, _program_size - at);
+    }
+
+    if (length == 0) {
+        return 0;
+    }
+
+    RuleFrame frame;
+    frame.rule = id;
+    frame.span = {offsetAt(_current_index), offsetAt(_current_index + length)};
+
+    applyRule(rules, frame);
+
+    return length;
+}
+
 }  // namespace lexer
 NAMESPACE_END
 
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <utility>
 #include <string_view>
 
@@ -17,6 +18,6 @@ NAMESPACE_BEGIN
  * @param start_index The index to start searching from.
  * @return A pair of indices that represent the start and end of the word at the given index.
  */
-std::pair<unsigned long, unsigned long> contegiousText(std::string_view text, unsigned long start_index = 0);
+std::pair<std::size_t, std::size_t> contegiousText(std::string_view text, std::size_t start_index = 0);
 
 NAMESPACE_END
\ No newline at end of file
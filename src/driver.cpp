@@ -0,0 +1,208 @@
+#include "../include/driver.h"
+#include "../include/lexer.h"
+#include "../include/source_file.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <format>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <system_error>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+using namespace NAMESPACE;
+
+namespace {
+
+#ifdef _WIN32
+
+std::chrono::nanoseconds cpuTime(const FILETIME &kernel, const FILETIME &user) {
+    auto ticks = [](const FILETIME &time) {
+        return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+
+    // FILETIME counts 100ns intervals
+    return std::chrono::nanoseconds((ticks(kernel) + ticks(user)) * 100);
+}
+
+#else
+
+std::chrono::nanoseconds cpuTime(clockid_t clock) {
+    timespec time{};
+    clock_gettime(clock, &time);
+    return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+}
+
+#endif
+
+double milliseconds(std::chrono::nanoseconds time) {
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+int usage() {
+    std::cerr << "usage: rara build <dir> [-j N]" << std::endl;
+    return 2;
+}
+
+std::optional<std::size_t> parseJobs(std::string_view text) {
+    std::size_t jobs = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), jobs);
+    if (error != std::errc() || end != text.data() + text.size() || jobs == 0) {
+        return std::nullopt;
+    }
+    return jobs;
+}
+
+}  // namespace
+
+std::chrono::nanoseconds driver::threadCpuTime() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    return cpuTime(kernel, user);
+#else
+    return cpuTime(CLOCK_THREAD_CPUTIME_ID);
+#endif
+}
+
+std::chrono::nanoseconds driver::processCpuTime() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    return cpuTime(kernel, user);
+#else
+    return cpuTime(CLOCK_PROCESS_CPUTIME_ID);
+#endif
+}
+
+std::vector<std::filesystem::path> driver::findSources(const std::filesystem::path &root) {
+    std::vector<std::filesystem::path> files;
+
+    auto options = std::filesystem::directory_options::skip_permission_denied;
+    for (auto &entry: std::filesystem::recursive_directory_iterator(root, options)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".ra") {
+            files.push_back(entry.path());
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+driver::FileResult driver::buildFile(const std::filesystem::path &path, lexer::Interner *names) {
+    const auto wall_start = std::chrono::steady_clock::now();
+    const auto cpu_start = threadCpuTime();
+
+    FileResult result;
+    result.path = path;
+
+    try {
+        auto file = SourceFile::open(path);
+        result.bytes = file.size();
+
+        auto lexer = lexer::Lexer(file);
+        result.tokens = (names != nullptr ? lexer.tokenize(*names) : lexer.tokenize()).size();
+    } catch (const std::system_error &error) {
+        result.error = error.what();
+    }
+
+    result.wall = std::chrono::steady_clock::now() - wall_start;
+    result.cpu = threadCpuTime() - cpu_start;
+    return result;
+}
+
+std::vector<driver::FileResult> driver::buildFiles(const std::vector<std::filesystem::path> &files, ThreadPool &pool,
+                                                   lexer::Interner *names) {
+    std::vector<std::future<FileResult>> tasks;
+    tasks.reserve(files.size());
+
+    for (auto &path: files) {
+        tasks.push_back(pool.submit([&path, names] { return buildFile(path, names); }));
+    }
+
+    // collected in submission order, whatever order they finished in
+    std::vector<FileResult> results;
+    results.reserve(tasks.size());
+    for (auto &task: tasks) {
+        results.push_back(task.get());
+    }
+
+    return results;
+}
+
+int driver::build(std::span<const std::string_view> args) {
+    std::optional<std::filesystem::path> root;
+    std::size_t jobs = 0;
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        auto arg = args[i];
+
+        if (arg.starts_with("-j")) {
+            auto value = arg.size() > 2 ? arg.substr(2) : (i + 1 < args.size() ? args[++i] : std::string_view{});
+            auto parsed = parseJobs(value);
+            if (!parsed) {
+                return usage();
+            }
+            jobs = *parsed;
+        } else if (!root) {
+            root = std::filesystem::path(arg);
+        } else {
+            return usage();
+        }
+    }
+
+    if (!root) {
+        return usage();
+    }
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(*root, error)) {
+        std::cerr << std::format("rara build: {} is not a directory", root->string()) << std::endl;
+        return 1;
+    }
+
+    const auto wall_start = std::chrono::steady_clock::now();
+    const auto cpu_start = processCpuTime();
+
+    ThreadPool pool(jobs);
+    auto names = lexer::Interner::concurrent();
+    auto results = buildFiles(findSources(*root), pool, &names);
+
+    const auto wall = std::chrono::steady_clock::now() - wall_start;
+    const auto cpu = processCpuTime() - cpu_start;
+
+    std::size_t bytes = 0;
+    std::size_t tokens = 0;
+    std::size_t failed = 0;
+
+    std::cout << std::format("{:>12} {:>10} {:>10} {:>10}  {}", "bytes", "tokens", "wall ms", "cpu ms", "file") << '\n';
+    for (auto &result: results) {
+        if (!result.error.empty()) {
+            std::cerr << std::format("{}: {}", result.path.string(), result.error) << '\n';
+            failed++;
+            continue;
+        }
+
+        bytes += result.bytes;
+        tokens += result.tokens;
+        std::cout << std::format("{:>12} {:>10} {:>10.3f} {:>10.3f}  {}", result.bytes, result.tokens,
+                                 milliseconds(result.wall), milliseconds(result.cpu), result.path.string())
+                  << '\n';
+    }
+
+    std::cout << std::format("{} files, {} bytes, {} tokens, {} names on {} threads, {:.3f} ms wall, {:.3f} ms cpu",
+                             results.size(), bytes, tokens, names.size(), pool.size(), milliseconds(wall),
+                             milliseconds(cpu))
+              << std::endl;
+
+    return failed == 0 ? 0 : 1;
+}
@@ -3,11 +3,27 @@
 using namespace rara;
 using namespace rara::lexer;
 
-Lexer::Lexer( std::string program ) {
-  this->program = program;
+Lexer::Lexer( std::string program )
+  : program( std::move( program ) ) {}
+
+Lexer::Lexer( const SourceFile& file )
+  : file( &file ) {}
+
+PaddedView Lexer::source() const {
+  return file != nullptr ? file->padded() : program.view();
+}
+
+TokenStream Lexer::tokenize() {
+  auto tokenizer = grammar::MaraTokenizer( source() );
+  return tokenizer.tokenize();
 }
 
-std::vector<Token> Lexer::tokenize() {
-  auto v = std::vector<Token>();
-  return v;
-}
\ No newline at end of file
+TokenStream Lexer::tokenize( Interner& names ) {
+  auto tokens = tokenize();
+  names.intern( source().text(), tokens );
+  return tokens;
+}
+
+grammar::MaraTokenizer Lexer::tokenizer() const {
+  return grammar::MaraTokenizer( source() );
+}
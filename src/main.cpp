@@ -1,10 +1,13 @@
 
+#include "../include/driver.h"
 #include "../include/lexer.h"
 #include "../include/tree.h"
 #include "../include/logger.h"
 
 #include <iostream>
 #include <format>
+#include <string_view>
+#include <vector>
 
 using namespace NAMESPACE;
 
@@ -12,6 +15,11 @@ int main(int argc, const char **argv) {
 
     setupLogger();
 
+    std::vector<std::string_view> args(argv + 1, argv + argc);
+    if (!args.empty() && args[0] == "build") {
+        return driver::build(std::span(args).subspan(1));
+    }
+
     std::string program = "a :: 2";
     lexer::Lexer lexer(program);
 
@@ -0,0 +1,244 @@
+#include "../include/source_file.h"
+
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace NAMESPACE;
+
+namespace {
+
+#ifdef _WIN32
+
+[[noreturn]] void fail(const std::filesystem::path &path) {
+    throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), path.string());
+}
+
+// Closes a handle when it goes out of scope
+struct Handle {
+    HANDLE handle;
+
+    ~Handle() {
+        if (handle != nullptr && handle != INVALID_HANDLE_VALUE) {
+            CloseHandle(handle);
+        }
+    }
+};
+
+#else
+
+[[noreturn]] void fail(const std::filesystem::path &path) {
+    throw std::system_error(errno, std::generic_category(), path.string());
+}
+
+// Closes a file descriptor when it goes out of scope
+struct Descriptor {
+    int fd;
+
+    ~Descriptor() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+#endif
+
+}  // namespace
+
+SourceFile SourceFile::open(const std::filesystem::path &path) {
+    SourceFile file;
+    file._path = path;
+
+#ifdef _WIN32
+    Handle handle{CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr)};
+    if (handle.handle == INVALID_HANDLE_VALUE) {
+        fail(path);
+    }
+
+    SYSTEM_INFO system{};
+    GetSystemInfo(&system);
+
+    LARGE_INTEGER size{};
+    if (GetFileType(handle.handle) == FILE_TYPE_DISK && GetFileSizeEx(handle.handle, &size)) {
+        // an empty file can't be mapped, there's nothing to read either
+        if (size.QuadPart == 0) {
+            file.useBuffer();
+            return file;
+        }
+
+        // the rest of the last page is zeros, a view can't be followed by more so the file is
+        // only mapped if they are enough padding
+        auto slack = system.dwPageSize - static_cast<std::size_t>(size.QuadPart) % system.dwPageSize;
+        Handle mapping{nullptr};
+        if (slack >= lexer::padding && slack != system.dwPageSize) {
+            mapping.handle = CreateFileMappingW(handle.handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+
+        if (mapping.handle != nullptr) {
+            if (auto view = MapViewOfFile(mapping.handle, FILE_MAP_READ, 0, 0, 0)) {
+                file._mapping = view;
+                file._data = static_cast<const char *>(view);
+                file._size = static_cast<std::size_t>(size.QuadPart);
+                return file;
+            }
+        }
+    }
+
+    // not a disk file or it couldn't be mapped
+    char chunk[64 * 1024];
+    while (true) {
+        DWORD read = 0;
+        if (!ReadFile(handle.handle, chunk, sizeof(chunk), &read, nullptr)) {
+            // the writing end of a pipe was closed
+            if (GetLastError() == ERROR_BROKEN_PIPE) {
+                break;
+            }
+            fail(path);
+        }
+        if (read == 0) {
+            break;
+        }
+        file._buffer.append(chunk, read);
+    }
+#else
+    Descriptor descriptor{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (descriptor.fd < 0) {
+        fail(path);
+    }
+
+    struct stat status{};
+    if (::fstat(descriptor.fd, &status) != 0) {
+        fail(path);
+    }
+
+    if (S_ISREG(status.st_mode)) {
+        // an empty file can't be mapped, there's nothing to read either
+        if (status.st_size == 0) {
+            file.useBuffer();
+            return file;
+        }
+
+        // zero pages for the file and its padding, the file is mapped over the start of them. The
+        // rest of its last page is zeros too.
+        auto size = static_cast<std::size_t>(status.st_size);
+        auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        auto length = (size + lexer::padding + page - 1) / page * page;
+
+        auto zeros = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (zeros != MAP_FAILED) {
+            auto view = ::mmap(zeros, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, descriptor.fd, 0);
+            if (view != MAP_FAILED) {
+                ::posix_madvise(view, size, POSIX_MADV_SEQUENTIAL);
+
+                file._mapping = view;
+                file._mapped_length = length;
+                file._data = static_cast<const char *>(view);
+                file._size = size;
+                return file;
+            }
+
+            ::munmap(zeros, length);
+        }
+    }
+
+    // a pipe, a device or a file that couldn't be mapped
+    char chunk[64 * 1024];
+    while (true) {
+        auto read = ::read(descriptor.fd, chunk, sizeof(chunk));
+        if (read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail(path);
+        }
+        if (read == 0) {
+            break;
+        }
+        file._buffer.append(chunk, static_cast<std::size_t>(read));
+    }
+#endif
+
+    file.useBuffer();
+    return file;
+}
+
+SourceFile SourceFile::read(std::istream &stream) {
+    SourceFile file;
+    file._buffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    file.useBuffer();
+    return file;
+}
+
+void SourceFile::useBuffer() {
+    _size = _buffer.size();
+    _buffer.resize(_size + lexer::padding, '\0');
+    _data = _buffer.data();
+}
+
+void SourceFile::useData() {
+    // a short buffer lives inside the string, the data pointer has to follow it. A buffer that was
+    // never filled has no padding.
+    if (_mapping != nullptr) {
+        _data = static_cast<const char *>(_mapping);
+    } else if (!_buffer.empty()) {
+        _data = _buffer.data();
+    } else {
+        _data = lexer::PaddedView().data();
+    }
+}
+
+SourceFile::SourceFile(SourceFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+SourceFile &SourceFile::operator=(SourceFile &&other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    unmap();
+
+    _path = std::move(other._path);
+    _mapping = std::exchange(other._mapping, nullptr);
+    _mapped_length = std::exchange(other._mapped_length, 0);
+    _buffer = std::move(other._buffer);
+    _size = std::exchange(other._size, 0);
+    other._buffer.clear();
+
+    useData();
+    other.useData();
+
+    return *this;
+}
+
+SourceFile::~SourceFile() {
+    unmap();
+}
+
+void SourceFile::unmap() {
+    if (_mapping == nullptr) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(_mapping);
+#else
+    ::munmap(_mapping, _mapped_length);
+#endif
+
+    _mapping = nullptr;
+}
@@ -0,0 +1,109 @@
+#include "../include/thread_pool.h"
+
+#include <algorithm>
+
+using namespace NAMESPACE;
+
+namespace {
+
+// The pool and worker the current thread belongs to, if any
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local std::size_t current_worker = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    _queues.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        _queues.push_back(std::make_unique<Queue>());
+    }
+
+    _workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        _workers.emplace_back([this, i] { work(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _ready.notify_all();
+
+    for (auto &worker: _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::push(std::function<void()> task) {
+    auto index = current_pool == this ? current_worker : _next++ % _queues.size();
+
+    // counted before it's queued so _pending never drops below the queued tasks
+    {
+        std::lock_guard lock(_mutex);
+        _pending++;
+    }
+
+    {
+        auto &queue = *_queues[index];
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    _ready.notify_one();
+}
+
+bool ThreadPool::take(std::size_t worker, std::function<void()> &task) {
+    {
+        auto &own = *_queues[worker];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (std::size_t i = 1; i < _queues.size(); ++i) {
+        auto &other = *_queues[(worker + i) % _queues.size()];
+        std::lock_guard lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::work(std::size_t worker) {
+    current_pool = this;
+    current_worker = worker;
+
+    while (true) {
+        std::function<void()> task;
+
+        if (take(worker, task)) {
+            {
+                std::lock_guard lock(_mutex);
+                _pending--;
+            }
+
+            task();
+            continue;
+        }
+
+        // a task that is counted but not queued yet only makes this loop run once more
+        std::unique_lock lock(_mutex);
+        _ready.wait(lock, [this] { return _stopping || _pending > 0; });
+
+        if (_stopping && _pending == 0) {
+            return;
+        }
+    }
+}
@@ -9,33 +9,108 @@ using namespace NAMESPACE::lexer;
 
 // FSM Implementation
 FSM::FSM(const std::string_view name, const std::string_view pattern)
-    : name(name), pattern(pattern) {
-  // Implement FSM construction logic based on the pattern
-}
-
-// Other FSM-related methods and members
+    : name(name), pattern(pattern), nfa(dfa::parse(pattern)) {}
 
 
 // FSMTokenizer Implementation
 FSMTokenizer::FSMTokenizer(const std::string_view program) : Tokenizer(program) {}
 
+FSMTokenizer::FSMTokenizer(PaddedView program) : Tokenizer(program) {}
+
 void FSMTokenizer::add_fsm(const std::string_view token_name, const std::string_view pattern) {
-  fsm_map.emplace(token_name, FSM(token_name, pattern));
+  logger::debug("Adding FSM {}: {}", token_name, pattern);
+
+  FSM fsm(token_name, pattern);
+
+  auto it = fsm_map.find(token_name);
+  if (it != fsm_map.end()) {
+    fsms[it->second] = std::move(fsm);
+  } else {
+    fsm_map.emplace(token_name, fsms.size());
+    fsms.push_back(std::move(fsm));
+  }
+
+  _compiled = false;
 }
 
-std::pair<bool, std::string_view> FSMTokenizer::match_fsm(const std::string_view input) {
-  for (const auto& entry : fsm_map) {
-    const auto token_name = entry.first;
-    const auto& fsm = entry.second;
+void FSMTokenizer::compile() {
+  if (_compiled) {
+    return;
+  }
 
-    // Implement FSM matching logic using the input and the FSM instance
-    // If there's a match, return true and the token_name
+  std::vector<dfa::Nfa> nfas;
+  nfas.reserve(fsms.size());
+  for (const auto& fsm : fsms) {
+    nfas.push_back(fsm.getNfa());
+  }
 
+  // accepting states are tagged with the index of their FSM
+  _dfa = dfa::compile(nfas);
+
+  _compiled = true;
+  logger::debug("Compiled {} FSMs into {} states", fsms.size(), _dfa.states());
+}
+
+std::pair<std::size_t, std::string_view> FSMTokenizer::match_fsm(const std::string_view input) {
+  if (fsms.empty()) {
+    return {0, ""};
+  }
+
+  compile();
+
+  auto match = dfa::munch(_dfa.view(), input, 0);
+  if (match.length == 0) {
+    return {0, ""};
   }
-  return {false, ""};
+
+  return {match.length, fsms[match.pattern].getName()};
 }
 
-void FSMTokenizer::handle_token(char c, std::vector<Token>& tokens) {
-  // Implement token handling logic using the FSMs in the fsm_map
-  // Call match_fsm() and create tokens based on the matching FSMs
-}
\ No newline at end of file
+void FSMTokenizer::evaluate(Scratch& scratch) {
+  while (step(scratch)) {}
+}
+
+bool FSMTokenizer::step(Scratch&) {
+  if (_current_index >= _program_size) {
+    return false;
+  }
+
+  // the longest match could go on in the next chunk of a streamed program
+  if (_stream_open && !fsms.empty()) {
+    compile();
+    if (dfa::munch(_dfa.view(), _program, _current_index).more) {
+      return false;
+    }
+  }
+
+  handle_token(_program[_current_index], _tokens);
+  markRestart();
+  return true;
+}
+
+void FSMTokenizer::handle_token(char, TokenStream& tokens) {
+  if (fsms.empty()) {
+    _current_index++;
+    return;
+  }
+
+  compile();
+
+  auto match = dfa::munch(_dfa.view(), _program, _current_index);
+  examine(_current_index + match.examined);
+
+  // no FSM starts with c, skip it
+  const auto length = match.length;
+  if (length == 0) {
+    _current_index++;
+    return;
+  }
+
+  auto kind = kindOf(fsms[match.pattern].getName());
+  if (kind != TokenKind::none) {
+    auto span = SourceSpan{offsetAt(_current_index), offsetAt(_current_index + length)};
+    pushToken(tokens, kind, span);
+  }
+
+  _current_index += length;
+}
@@ -0,0 +1,181 @@
+#include "../include/tokenizer/interner.h"
+#include "../include/tokenizer/arena.h"
+#include "../include/tokenizer/scan.h"
+
+#include <parallel_hashmap/phmap.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+using namespace NAMESPACE::lexer;
+
+namespace {
+
+// A name and the hash of its text, computed once when the name is looked up
+struct Key {
+    std::string_view text;
+    std::size_t hash = 0;
+
+    bool operator==(const Key &other) const { return text == other.text; }
+};
+
+struct KeyHash {
+    std::size_t operator()(const Key &key) const { return key.hash; }
+};
+
+std::size_t hashOf(std::string_view text) {
+    return phmap::Hash<std::string_view>()(text);
+}
+
+}  // namespace
+
+struct Interner::Shard {
+    // only locked by a concurrent interner
+    mutable std::mutex mutex;
+
+    Arena arena;
+    phmap::flat_hash_map<Key, NameId, KeyHash> ids;
+
+    // texts by the index part of their ids
+    std::vector<std::string_view> names;
+};
+
+Interner::Interner() : Interner(1, false) {}
+
+Interner::Interner(std::size_t shards, bool concurrent) : _concurrent(concurrent) {
+    shards = std::bit_ceil(std::clamp<std::size_t>(shards, 1, 256));
+    _shard_bits = static_cast<unsigned>(std::countr_zero(shards));
+
+    for (std::size_t i = 0; i < shards; ++i) {
+        _shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+Interner Interner::concurrent(std::size_t shards) {
+    return {shards, true};
+}
+
+Interner::Interner(Interner &&other) noexcept = default;
+
+Interner &Interner::operator=(Interner &&other) noexcept = default;
+
+Interner::~Interner() = default;
+
+NameId Interner::intern(std::string_view text) {
+    const Key key{text, hashOf(text)};
+
+    // the map uses the low bits of the hash, the shard is picked with higher ones
+    const auto index = (key.hash >> 24) & (_shards.size() - 1);
+    auto &shard = *_shards[index];
+
+    std::unique_lock lock(shard.mutex, std::defer_lock);
+    if (_concurrent) {
+        lock.lock();
+    }
+
+    auto found = shard.ids.find(key);
+    if (found != shard.ids.end()) {
+        return found->second;
+    }
+
+    // id 0 is no_name, the index part has the bits the shard part doesn't
+    const auto limit = (std::uint64_t(1) << (32 - _shard_bits)) - 1;
+    if (shard.names.size() >= limit) {
+        throw std::length_error("too many names for 32 bit ids");
+    }
+
+    const auto id = static_cast<NameId>(((shard.names.size() << _shard_bits) | index) + 1);
+    const auto stored = shard.arena.store(text);
+
+    shard.names.push_back(stored);
+    shard.ids.emplace(Key{stored, key.hash}, id);
+    return id;
+}
+
+NameId Interner::find(std::string_view text) const {
+    const Key key{text, hashOf(text)};
+    const auto &shard = *_shards[(key.hash >> 24) & (_shards.size() - 1)];
+
+    std::unique_lock lock(shard.mutex, std::defer_lock);
+    if (_concurrent) {
+        lock.lock();
+    }
+
+    auto found = shard.ids.find(key);
+    return found != shard.ids.end() ? found->second : no_name;
+}
+
+std::string_view Interner::text(NameId id) const {
+    const auto value = id - 1;
+    const auto &shard = *_shards[value & (_shards.size() - 1)];
+
+    std::unique_lock lock(shard.mutex, std::defer_lock);
+    if (_concurrent) {
+        lock.lock();
+    }
+
+    return shard.names[value >> _shard_bits];
+}
+
+std::size_t Interner::size() const {
+    std::size_t size = 0;
+    for (auto &shard: _shards) {
+        std::unique_lock lock(shard->mutex, std::defer_lock);
+        if (_concurrent) {
+            lock.lock();
+        }
+        size += shard->names.size();
+    }
+    return size;
+}
+
+void Interner::intern(std::string_view program, TokenStream &tokens) {
+    internRange(program, tokens, tokens.nameSlots(), 0, tokens.size());
+}
+
+void Interner::intern(std::string_view program, TokenStream &tokens, ThreadPool &pool) {
+    // fewer tokens than this aren't worth a task
+    constexpr std::size_t min_tokens = 16 * 1024;
+
+    const auto size = tokens.size();
+    const auto pieces = std::min(pool.size(), size / min_tokens);
+    if (!_concurrent || pieces <= 1) {
+        intern(program, tokens);
+        return;
+    }
+
+    auto names = tokens.nameSlots();
+
+    std::vector<std::future<void>> tasks;
+    for (std::size_t i = 0; i < pieces; ++i) {
+        tasks.push_back(pool.submit([&, begin = size * i / pieces, end = size * (i + 1) / pieces] {
+            internRange(program, tokens, names, begin, end);
+        }));
+    }
+
+    // every task has to be done before tokens can go away, even if one threw
+    for (auto &task: tasks) {
+        task.wait();
+    }
+    for (auto &task: tasks) {
+        task.get();
+    }
+}
+
+void Interner::internRange(std::string_view program, const TokenStream &tokens, std::span<NameId> names,
+                           std::size_t begin, std::size_t end) {
+    const auto kinds = tokens.kinds();
+    const auto offsets = tokens.offsets();
+    const auto lengths = tokens.lengths();
+
+    for (auto i = begin; i < end; ++i) {
+        if (kinds[i] == TokenKind::identifier) {
+            // the span of a rule can reach into its terminator, the name is the word it starts with
+            const auto text = program.substr(offsets[i], lengths[i]);
+            names[i] = intern(text.substr(0, scan::wordRun(text)));
+        }
+    }
+}
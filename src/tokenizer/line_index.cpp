@@ -0,0 +1,33 @@
+#include "../include/tokenizer/line_index.h"
+#include "../include/tokenizer/scan.h"
+
+#include <algorithm>
+
+using namespace NAMESPACE::lexer;
+
+LineIndex::LineIndex(std::string_view program) {
+    _line_starts.push_back(0);
+
+    for (auto newline = scan::findByte(program, '\n'); newline < program.size();
+         newline = scan::findByte(program, '\n', newline + 1)) {
+        _line_starts.push_back(static_cast<SourceOffset>(newline + 1));
+    }
+}
+
+LineIndex::Position LineIndex::resolve(SourceOffset offset) const {
+    if (_line_starts.empty()) {
+        return {1, offset + 1};
+    }
+
+    // the last line starting at or before offset
+    auto line = std::upper_bound(_line_starts.begin(), _line_starts.end(), offset) - 1;
+
+    return {static_cast<std::uint64_t>(line - _line_starts.begin() + 1), offset - *line + 1};
+}
+
+CodeLocation LineIndex::resolve(SourceSpan span) const {
+    auto start = resolve(span.begin);
+    auto end = resolve(span.end > span.begin ? span.end - 1 : span.begin);
+
+    return {start.line, start.column, end.line, end.column};
+}
@@ -0,0 +1,373 @@
+#include "../include/tokenizer/number.h"
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <utility>
+
+using namespace NAMESPACE::lexer;
+
+namespace {
+
+constexpr bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// SWAR needs the bytes in memory order, on a big endian machine only the scalar loops run
+constexpr bool swar = std::endian::native == std::endian::little;
+
+std::uint64_t load(const char *p) {
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// All eight bytes are '0' to '9': no high nibble other than 3, and none that adding 6 carries out of
+bool eightDigits(std::uint64_t bytes) {
+    return ((bytes & 0xF0F0F0F0F0F0F0F0) | (((bytes + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+           0x3333333333333333;
+}
+
+// The value of eight digits, the first one in the lowest byte. Pairs, then quads, then all eight
+// are combined with a multiply each.
+std::uint32_t parseEight(std::uint64_t bytes) {
+    constexpr std::uint64_t mask = 0x000000FF000000FF;
+    constexpr std::uint64_t mul1 = 0x000F424000000064;  // 100 + (1000000 << 32)
+    constexpr std::uint64_t mul2 = 0x0000271000000001;  // 1 + (10000 << 32)
+
+    bytes -= 0x3030303030303030;
+    bytes = bytes * 10 + (bytes >> 8);
+    bytes = ((bytes & mask) * mul1 + ((bytes >> 16) & mask) * mul2) >> 32;
+    return static_cast<std::uint32_t>(bytes);
+}
+
+// End of the digit run at p
+const char *digitsEnd(const char *p, const char *end) {
+    if constexpr (swar) {
+        while (end - p >= 8 && eightDigits(load(p))) {
+            p += 8;
+        }
+    }
+
+    while (p != end && isDigit(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+// value followed by the digits [p, end), the result has to fit 64 bits
+std::uint64_t accumulate(std::uint64_t value, const char *p, const char *end) {
+    if constexpr (swar) {
+        while (end - p >= 8) {
+            value = value * 100000000 + parseEight(load(p));
+            p += 8;
+        }
+    }
+
+    for (; p != end; ++p) {
+        value = value * 10 + static_cast<std::uint64_t>(*p - '0');
+    }
+    return value;
+}
+
+// Digits that always fit an unsigned 64 bit integer
+constexpr std::ptrdiff_t max_digits = 19;
+
+Number decodeInteger(const char *p, const char *end) {
+    while (p != end && *p == '0') {
+        ++p;
+    }
+
+    Number number;
+    constexpr auto max = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+
+    auto value = end - p <= max_digits ? accumulate(0, p, end) : max + 1;
+    if (value > max) {
+        number.overflow = true;
+        value = max;
+    }
+
+    number.integer = static_cast<std::int64_t>(value);
+    return number;
+}
+
+// Eisel-Lemire ------------------------------------------------------------------------------------
+
+// Powers of ten with a table entry, decimal exponents outside are left to the fallback
+constexpr int min_power = -128;
+constexpr int max_power = 128;
+
+struct U128 {
+    std::uint64_t high = 0;
+    std::uint64_t low = 0;
+};
+
+constexpr U128 multiply(std::uint64_t a, std::uint64_t b) {
+    const auto a_lo = a & 0xFFFFFFFF, a_hi = a >> 32;
+    const auto b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+
+    const auto lo_lo = a_lo * b_lo;
+    const auto hi_lo = a_hi * b_lo;
+    const auto lo_hi = a_lo * b_hi;
+    const auto hi_hi = a_hi * b_hi;
+
+    const auto cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    return {hi_hi + (hi_lo >> 32) + (cross >> 32), (cross << 32) | (lo_lo & 0xFFFFFFFF)};
+}
+
+/**
+ * @brief Just enough of an unsigned big integer to build the power of five table, 32 bit limbs with
+ *        the lowest first.
+ */
+struct Big {
+    std::array<std::uint32_t, 32> limbs{};
+
+    static constexpr Big power2(int exponent) {
+        Big big;
+        big.limbs[exponent / 32] = std::uint32_t(1) << (exponent % 32);
+        return big;
+    }
+
+    constexpr void multiply5() {
+        std::uint64_t carry = 0;
+        for (auto &limb: limbs) {
+            carry += std::uint64_t(limb) * 5;
+            limb = static_cast<std::uint32_t>(carry);
+            carry >>= 32;
+        }
+    }
+
+    // Divides by 5^exponent, rounding down
+    constexpr void dividePower5(int exponent) {
+        // 5^13 is the largest power that fits a limb
+        for (; exponent > 0; exponent -= 13) {
+            std::uint64_t divisor = 1;
+            for (int i = 0; i < std::min(exponent, 13); ++i) {
+                divisor *= 5;
+            }
+
+            std::uint64_t rest = 0;
+            for (auto i = static_cast<std::size_t>((bits() + 31) / 32); i-- > 0;) {
+                rest = (rest << 32) | limbs[i];
+                limbs[i] = static_cast<std::uint32_t>(rest / divisor);
+                rest %= divisor;
+            }
+        }
+    }
+
+    constexpr void increment() {
+        for (auto &limb: limbs) {
+            if (++limb != 0) {
+                break;
+            }
+        }
+    }
+
+    [[nodiscard]] constexpr int bits() const {
+        for (auto i = limbs.size(); i-- > 0;) {
+            if (limbs[i] != 0) {
+                return static_cast<int>(i * 32) + std::bit_width(limbs[i]);
+            }
+        }
+        return 0;
+    }
+
+    [[nodiscard]] constexpr bool bit(int index) const {
+        return index >= 0 && (limbs[index / 32] >> (index % 32)) & 1;
+    }
+
+    // The 128 bits that end with the highest set bit, shifted up if there are fewer
+    [[nodiscard]] constexpr U128 top() const {
+        const auto lowest = bits() - 128;
+
+        U128 result;
+        for (int i = 0; i < 64; ++i) {
+            result.low |= std::uint64_t(bit(lowest + i)) << i;
+            result.high |= std::uint64_t(bit(lowest + 64 + i)) << i;
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief 5^q for min_power <= q <= max_power, normalized to 128 bits with the top bit set. Positive
+ *        powers are truncated, negative ones are 2^b / 5^-q rounded up, the same table as the
+ *        reference implementation.
+ */
+constexpr auto powers_of_five = [] {
+    std::array<U128, max_power - min_power + 1> table{};
+
+    auto power = Big::power2(0);
+    for (int q = 0; q <= max_power; ++q) {
+        table[q - min_power] = power.top();
+        power.multiply5();
+    }
+
+    power = Big::power2(0);
+    for (int k = 1; k <= -min_power; ++k) {
+        power.multiply5();
+
+        // 5^k isn't a power of two, so it takes z bits to hold the smallest power of two above it
+        const auto z = power.bits();
+        auto reciprocal = Big::power2(k <= 27 ? z + 127 : 2 * z + 128);
+        reciprocal.dividePower5(k);
+        reciprocal.increment();
+
+        table[-k - min_power] = reciprocal.top();
+    }
+
+    return table;
+}();
+
+// floor(log2(10^q)) + 63, exact for the exponents in the table
+constexpr int binaryPower(int q) {
+    return (((152170 + 65536) * q) >> 16) + 63;
+}
+
+/**
+ * @brief w * 10^q rounded to the nearest double, nothing if the 128 bit product can't decide it or
+ *        the result is subnormal.
+ */
+std::optional<double> eiselLemire(int q, std::uint64_t w) {
+    if (w == 0) {
+        return 0.0;
+    }
+    if (q < min_power || q > max_power) {
+        return std::nullopt;
+    }
+
+    constexpr int mantissa_bits = 52;
+    constexpr int shift = 64 - mantissa_bits - 3;
+
+    const auto zeros = std::countl_zero(w);
+    w <<= zeros;
+
+    const auto &power = powers_of_five[q - min_power];
+    auto product = multiply(w, power.high);
+
+    // the bits below the mantissa and the rounding bits are all ones, the low half could carry into them
+    constexpr auto precision_mask = ~std::uint64_t(0) >> (mantissa_bits + 3);
+    if ((product.high & precision_mask) == precision_mask) {
+        const auto second = multiply(w, power.low);
+        product.low += second.high;
+        if (second.high > product.low) {
+            product.high++;
+        }
+
+        // the product is only known to be exact for these exponents
+        if (product.low == ~std::uint64_t(0) && (q < -27 || q > 55)) {
+            return std::nullopt;
+        }
+    }
+
+    const auto upper = static_cast<int>(product.high >> 63);
+    auto mantissa = product.high >> (upper + shift);
+    auto exponent = binaryPower(q) + upper - zeros + 1023;
+
+    if (exponent <= 0) {
+        return std::nullopt;
+    }
+
+    // exactly halfway between two doubles, round to even
+    if (product.low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 &&
+        (mantissa << (upper + shift)) == product.high) {
+        mantissa &= ~std::uint64_t(1);
+    }
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (std::uint64_t(2) << mantissa_bits)) {
+        mantissa = std::uint64_t(1) << mantissa_bits;
+        exponent++;
+    }
+    mantissa &= ~(std::uint64_t(1) << mantissa_bits);
+
+    if (exponent >= 0x7FF) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    return std::bit_cast<double>(mantissa | static_cast<std::uint64_t>(exponent) << mantissa_bits);
+}
+
+// Powers of ten that are exact doubles
+constexpr std::array<double, 23> exact_powers = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                                 1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                                 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+Number decodeReal(const char *begin, const char *int_end, const char *fraction, const char *end) {
+    Number number;
+    number.type = Number::Type::real;
+
+    // leading zeros don't count towards the digits that fit, in front of the point or after it
+    auto p = begin;
+    while (p != int_end && *p == '0') {
+        ++p;
+    }
+    auto f = fraction;
+    if (p == int_end) {
+        while (f != end && *f == '0') {
+            ++f;
+        }
+    }
+
+    const auto int_digits = int_end - p;
+    const auto fraction_digits = end - f;
+
+    // the literal is w * 10^q, w keeps the first max_digits digits
+    std::uint64_t w;
+    int q;
+    bool truncated = int_digits + fraction_digits > max_digits;
+
+    if (int_digits >= max_digits) {
+        w = accumulate(0, p, p + max_digits);
+        q = static_cast<int>(int_digits - max_digits);
+    } else {
+        const auto taken = std::min(fraction_digits, max_digits - int_digits);
+        w = accumulate(accumulate(0, p, int_end), f, f + taken);
+        q = -static_cast<int>((f - fraction) + taken);
+    }
+
+    std::optional<double> value;
+    if (!truncated && w <= (std::uint64_t(1) << 53) && q >= -22 && q <= 22) {
+        // both are exact, one rounding
+        const auto digits = static_cast<double>(w);
+        value = q < 0 ? digits / exact_powers[-q] : digits * exact_powers[q];
+    } else {
+        value = eiselLemire(q, w);
+
+        // the dropped digits lie between w and w + 1, both have to round the same way
+        if (value && truncated && eiselLemire(q, w + 1) != value) {
+            value.reset();
+        }
+    }
+
+    if (!value) {
+        double parsed = 0;
+        auto [_, error] = std::from_chars(begin, end, parsed, std::chars_format::fixed);
+        value = error == std::errc::result_out_of_range ? std::numeric_limits<double>::infinity() : parsed;
+    }
+
+    number.real = *value;
+    number.overflow = std::isinf(number.real);
+    return number;
+}
+
+}  // namespace
+
+Number NAMESPACE::lexer::decodeNumber(std::string_view text) {
+    const auto begin = text.data();
+    const auto end = begin + text.size();
+
+    const auto int_end = digitsEnd(begin, end);
+
+    // a point only starts a fraction if a digit follows it
+    if (end - int_end >= 2 && *int_end == '.' && isDigit(int_end[1])) {
+        return decodeReal(begin, int_end, int_end + 1, digitsEnd(int_end + 1, end));
+    }
+
+    return decodeInteger(begin, int_end);
+}
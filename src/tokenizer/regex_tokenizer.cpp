@@ -3,31 +3,84 @@
 //
 
 #include "../include/tokenizer/regex_tokenizer.h"
-#include "../include/tokenizer/token_factory.h"
+#include "../include/tokenizer/grammar.h"
 
 
 using namespace NAMESPACE::lexer;
 
-RegexTokenizer::RegexTokenizer(const std::string_view program)
-    : Tokenizer(program) {
-  // Initialize additional regular expressions for other token types as needed
+RegexTokenizer::RegexTokenizer(const std::string_view program) : Tokenizer(program) {}
+
+RegexTokenizer::RegexTokenizer(PaddedView program) : Tokenizer(program) {}
+
+const dfa::Dfa& RegexTokenizer::combined() {
+  // built once, the initialization is thread safe
+  static const dfa::Dfa shared = [] {
+    auto result = dfa::compile(patterns);
+    logger::debug("Compiled {} regex patterns into {} states", patterns.size(), result.states());
+    return result;
+  }();
+
+  return shared;
+}
+
+std::pair<std::size_t, RegexTokenizer::Pattern> RegexTokenizer::match(std::string_view input) {
+  auto match = dfa::munch(combined().view(), input, 0);
+  if (match.length == 0) {
+    return {0, Pattern::none};
+  }
+
+  return {match.length, static_cast<Pattern>(match.pattern)};
+}
+
+void RegexTokenizer::evaluate(Scratch& scratch) {
+  while (step(scratch)) {}
 }
 
-void RegexTokenizer::handle_token(char c, std::vector<Token>& tokens) {
-  // Convert the current character to a string
-  std::string current_char(1, c);
+bool RegexTokenizer::step(Scratch& scratch) {
+  if (_current_index >= _program_size) {
+    return false;
+  }
+
+  // the longest match could go on in the next chunk of a streamed program
+  if (_stream_open && dfa::munch(combined().view(), _program, _current_index).more) {
+    return false;
+  }
+
+  handle_token(_program[_current_index], _tokens);
+  markRestart();
+  return true;
+}
 
-  auto line = 0;
-  auto column = 0;
+void RegexTokenizer::handle_token(char c, TokenStream& tokens) {
+  auto match = dfa::munch(combined().view(), _program, _current_index);
+  examine(_current_index + match.examined);
+
+  // no pattern starts with c, skip it
+  const auto length = match.length;
+  if (length == 0) {
+    _current_index++;
+    return;
+  }
+
+  auto kind = TokenKind::none;
+  switch (static_cast<Pattern>(match.pattern)) {
+    case Pattern::keyword:
+      kind = grammar::keywordKind(_program.substr(_current_index, length));
+      break;
+    case Pattern::identifier:
+      kind = TokenKind::identifier;
+      break;
+    case Pattern::number:
+      kind = TokenKind::number;
+      break;
+    default:
+      break;
+  }
 
-  // Check if the current character matches any of the regular expressions
-  if (std::regex_match(current_char, keyword_regex)) {
-    tokens.push_back(TokenFactory::create_token(current_char, "keyword", "", line, column));
-  } else if (std::regex_match(current_char, identifier_regex)) {
-    tokens.push_back(TokenFactory::create_token(current_char, "identifier", "", line, column));
-  } else if (std::regex_match(current_char, number_regex)) {
-    tokens.push_back(TokenFactory::create_token(current_char, "number", "", line, column));
+  if (kind != TokenKind::none) {
+    auto span = SourceSpan{offsetAt(_current_index), offsetAt(_current_index + length)};
+    pushToken(tokens, kind, span);
   }
 
-  // Add more checks for other token types based on their regular expressions
+  _current_index += length;
 }
@@ -0,0 +1,265 @@
+#include "../include/tokenizer/scan.h"
+
+#include <bit>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RARA_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace NAMESPACE::lexer;
+using namespace NAMESPACE::lexer::scan;
+
+namespace {
+
+std::size_t tableRun(CharClass cls, const char *data, std::size_t size) {
+    std::size_t i = 0;
+    while (i < size && is(data[i], cls)) {
+        i++;
+    }
+    return i;
+}
+
+#if defined(__AVX2__)
+
+constexpr std::size_t block = 32;
+
+__m256i inRange(__m256i v, char lo, char hi) {
+    auto above = _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(lo)), v);
+    auto below = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(hi)), v);
+    return _mm256_and_si256(above, below);
+}
+
+// One bit per byte of the block, set if the byte is in cls
+std::uint64_t classify(CharClass cls, const char *data) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+    __m256i in;
+
+    switch (cls) {
+        case CharClass::alpha:
+            // setting 0x20 folds upper case onto lower case
+            in = inRange(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+            break;
+        case CharClass::digit:
+            in = inRange(v, '0', '9');
+            break;
+        case CharClass::word:
+            in = _mm256_or_si256(
+                    _mm256_or_si256(inRange(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z'), inRange(v, '0', '9')),
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+            break;
+        default:
+            in = _mm256_or_si256(inRange(v, '\t', '\r'), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+            break;
+    }
+
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(in));
+}
+
+// One bit per byte of the block, set if the byte is a and the next one b
+std::uint64_t matchPair(const char *data, char a, char b) {
+    auto first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+    auto second = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 1));
+    auto in = _mm256_and_si256(_mm256_cmpeq_epi8(first, _mm256_set1_epi8(a)),
+                               _mm256_cmpeq_epi8(second, _mm256_set1_epi8(b)));
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(in));
+}
+
+#elif defined(RARA_SCAN_SSE2)
+
+constexpr std::size_t block = 16;
+
+__m128i inRange(__m128i v, char lo, char hi) {
+    auto above = _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(lo)), v);
+    auto below = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(hi)), v);
+    return _mm_and_si128(above, below);
+}
+
+// One bit per byte of the block, set if the byte is in cls
+std::uint64_t classify(CharClass cls, const char *data) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    __m128i in;
+
+    switch (cls) {
+        case CharClass::alpha:
+            // setting 0x20 folds upper case onto lower case
+            in = inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+            break;
+        case CharClass::digit:
+            in = inRange(v, '0', '9');
+            break;
+        case CharClass::word:
+            in = _mm_or_si128(
+                    _mm_or_si128(inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z'), inRange(v, '0', '9')),
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+            break;
+        default:
+            in = _mm_or_si128(inRange(v, '\t', '\r'), _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+            break;
+    }
+
+    return static_cast<std::uint16_t>(_mm_movemask_epi8(in));
+}
+
+// One bit per byte of the block, set if the byte is a and the next one b
+std::uint64_t matchPair(const char *data, char a, char b) {
+    auto first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    auto second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 1));
+    auto in = _mm_and_si128(_mm_cmpeq_epi8(first, _mm_set1_epi8(a)), _mm_cmpeq_epi8(second, _mm_set1_epi8(b)));
+    return static_cast<std::uint16_t>(_mm_movemask_epi8(in));
+}
+
+#else
+
+// SWAR fallback, 8 bytes in a 64 bit word
+constexpr std::size_t block = 8;
+
+constexpr std::uint64_t ones = 0x0101010101010101ull;
+constexpr std::uint64_t highs = 0x8080808080808080ull;
+
+// High bit of every byte in [lo, hi], bytes >= 0x80 are never in range
+constexpr std::uint64_t inRange(std::uint64_t x, unsigned char lo, unsigned char hi) {
+    auto low7 = x & ~highs;
+    auto above = (low7 + ones * (0x80 - lo)) & highs;
+    auto below = ~(low7 + ones * (0x7f - hi)) & highs;
+    return above & below & ~x;
+}
+
+// Gathers the high bits into the low byte, bit i for byte i
+constexpr std::uint64_t gather(std::uint64_t highs_set) {
+    return ((highs_set >> 7) * 0x0102040810204080ull) >> 56;
+}
+
+std::uint64_t classify(CharClass cls, const char *data) {
+    // byte i of the block is byte i of x, run() doesn't get here on big endian targets
+    std::uint64_t x;
+    std::memcpy(&x, data, sizeof(x));
+
+    std::uint64_t in;
+    switch (cls) {
+        case CharClass::alpha:
+            in = inRange(x | ones * 0x20, 'a', 'z');
+            break;
+        case CharClass::digit:
+            in = inRange(x, '0', '9');
+            break;
+        case CharClass::word:
+            in = inRange(x | ones * 0x20, 'a', 'z') | inRange(x, '0', '9') | inRange(x, '_', '_');
+            break;
+        default:
+            in = inRange(x, '\t', '\r') | inRange(x, ' ', ' ');
+            break;
+    }
+
+    return gather(in);
+}
+
+// One bit per byte of the block, set if the byte is a and the next one b
+std::uint64_t matchPair(const char *data, char a, char b) {
+    std::uint64_t first;
+    std::uint64_t second;
+    std::memcpy(&first, data, sizeof(first));
+    std::memcpy(&second, data + 1, sizeof(second));
+
+    // a byte is zero where it matched, highs of zero bytes as in "has zero byte"
+    auto x = first ^ ones * static_cast<unsigned char>(a);
+    auto y = second ^ ones * static_cast<unsigned char>(b);
+    auto zero = [](std::uint64_t v) { return ~(((v & ~highs) + ~highs) | v) & highs; };
+
+    return gather(zero(x) & zero(y));
+}
+
+#endif
+
+}  // namespace
+
+std::size_t scan::run(CharClass cls, const char *data, std::size_t size) {
+    constexpr auto full = (std::uint64_t(1) << block) - 1;
+
+    std::size_t i = 0;
+    if constexpr (std::endian::native != std::endian::little) {
+        return tableRun(cls, data, size);
+    }
+
+    for (; i + block <= size; i += block) {
+        auto in = classify(cls, data + i);
+        if (in != full) {
+            return i + std::countr_one(in);
+        }
+    }
+
+    return i + tableRun(cls, data + i, size - i);
+}
+
+std::size_t scan::paddedRun(CharClass cls, const char *data) {
+    constexpr auto full = (std::uint64_t(1) << block) - 1;
+    static_assert(block <= padding);
+
+    if constexpr (std::endian::native != std::endian::little) {
+        return tableRun(cls, data, SIZE_MAX);
+    }
+
+    // a block is only passed if all of it is in cls, so the next one starts at most at the
+    // first zero and ends inside the padding
+    for (std::size_t i = 0;; i += block) {
+        auto in = classify(cls, data + i);
+        if (in != full) {
+            return i + std::countr_one(in);
+        }
+    }
+}
+
+std::size_t scan::findByte(std::string_view text, char c, std::size_t from) {
+    if (from >= text.size()) {
+        return text.size();
+    }
+
+    // the C library's memchr is vectorized already
+    auto found = static_cast<const char *>(std::memchr(text.data() + from, c, text.size() - from));
+    return found == nullptr ? text.size() : found - text.data();
+}
+
+std::size_t scan::findPair(std::string_view text, char a, char b, std::size_t from) {
+    const auto *data = text.data();
+    const auto size = text.size();
+
+    std::size_t i = from;
+    if constexpr (std::endian::native == std::endian::little) {
+        // a block reads one byte past its end
+        for (; i + block + 1 <= size; i += block) {
+            auto in = matchPair(data + i, a, b);
+            if (in != 0) {
+                return i + std::countr_zero(in);
+            }
+        }
+    }
+
+    for (; i + 1 < size; ++i) {
+        if (data[i] == a && data[i + 1] == b) {
+            return i;
+        }
+    }
+    return size;
+}
+
+std::size_t scan::findPair(PaddedView text, char a, char b, std::size_t from) {
+    const auto *data = text.data();
+    const auto size = text.size();
+
+    if constexpr (std::endian::native != std::endian::little) {
+        return findPair(text.text(), a, b, from);
+    }
+
+    // a is never zero so nothing matches in the padding, the last block reads one byte past
+    // its end, still inside the padding
+    for (auto i = from; i < size; i += block) {
+        auto in = matchPair(data + i, a, b);
+        if (in != 0) {
+            return i + std::countr_zero(in);
+        }
+    }
+    return size;
+}
@@ -0,0 +1,100 @@
+#include "../include/tokenizer/string_literal.h"
+#include "../include/tokenizer/scan.h"
+
+#include <cstring>
+#include <optional>
+
+using namespace NAMESPACE::lexer;
+
+namespace {
+
+// The byte the escape \c stands for, nothing if it isn't one
+std::optional<char> escapeOf(char c) {
+    switch (c) {
+        case 'n':
+            return '\n';
+        case 't':
+            return '\t';
+        case 'r':
+            return '\r';
+        case '0':
+            return '\0';
+        case '\\':
+        case '\'':
+        case '"':
+            return c;
+        default:
+            return std::nullopt;
+    }
+}
+
+// Decodes body into out, which has room for body.size() bytes, returns the bytes written
+std::size_t decode(std::string_view body, char *out) {
+    std::size_t written = 0;
+    std::size_t i = 0;
+
+    while (i < body.size()) {
+        // the bytes up to the next backslash are copied at once
+        auto slash = scan::findByte(body, '\\', i);
+        std::memcpy(out + written, body.data() + i, slash - i);
+        written += slash - i;
+
+        if (slash + 1 >= body.size()) {
+            // a backslash at the end stays
+            if (slash < body.size()) {
+                out[written++] = '\\';
+            }
+            break;
+        }
+
+        if (auto c = escapeOf(body[slash + 1])) {
+            out[written++] = *c;
+        } else {
+            out[written++] = '\\';
+            out[written++] = body[slash + 1];
+        }
+        i = slash + 2;
+    }
+
+    return written;
+}
+
+std::string_view decodeInto(std::string_view body, Arena &arena) {
+    // the value is never longer than body
+    auto *out = arena.allocate(body.size());
+    auto written = decode(body, out);
+    arena.release(body.size() - written);
+    return {out, written};
+}
+
+}  // namespace
+
+std::string_view NAMESPACE::lexer::stringBody(std::string_view literal) {
+    if (!literal.empty() && literal.front() == '"') {
+        literal.remove_prefix(1);
+    }
+    if (!literal.empty() && literal.back() == '"') {
+        literal.remove_suffix(1);
+    }
+    return literal;
+}
+
+bool NAMESPACE::lexer::hasEscapes(std::string_view text) {
+    return scan::findByte(text, '\\') != text.size();
+}
+
+std::string_view NAMESPACE::lexer::unescape(std::string_view body, Arena &arena) {
+    return hasEscapes(body) ? decodeInto(body, arena) : body;
+}
+
+void NAMESPACE::lexer::unescape(std::string_view body, std::string &out) {
+    const auto size = out.size();
+    out.resize(size + body.size());
+    out.resize(size + decode(body, out.data() + size));
+}
+
+std::string_view NAMESPACE::lexer::stringValue(const TokenStream &tokens, std::size_t index, std::string_view program,
+                                               Arena &arena) {
+    auto body = stringBody(tokens[index].span.text(program));
+    return tokens.escaped(index) ? decodeInto(body, arena) : body;
+}
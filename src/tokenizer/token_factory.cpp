@@ -3,15 +3,35 @@
 //
 
 #include "../include/tokenizer/token_factory.h"
-
-#include <stdexcept>
+#include "../include/tokenizer/grammar.h"
+#include "../include/tokenizer/perfect_hash.h"
 
 using namespace NAMESPACE::lexer;
 
+namespace {
+
+constexpr PerfectHash<IdentifierType, 6> identifier_types({{
+        {"any", IdentifierType::any},
+        {"identifier", IdentifierType::identifier},
+        {"type", IdentifierType::type},
+        {"token", IdentifierType::token},
+        {"value", IdentifierType::value},
+        {"literal", IdentifierType::literal},
+}}, IdentifierType::none);
+
+constexpr PerfectHash<ExpressionType, 3> expression_types({{
+        {"any", ExpressionType::any},
+        {"declaration", ExpressionType::declaration},
+        {"assignment", ExpressionType::assignment},
+}}, ExpressionType::none);
+
+}  // namespace
+
 Token TokenFactory::create_token(std::string_view symbol, std::string_view identifier_type, std::string_view expression_type,
-                                 unsigned int line, unsigned int column) {
+                                 SourceSpan span) {
     Token token;
-    token.location = {line, column, line, column};
+    token.span = span;
+    token.kind = grammar::keywordKind(symbol);
     token.symbol = string_to_symbol(symbol);
     token.identifier_type = string_to_identifier_type(identifier_type);
     token.expression_type = string_to_expression_type(expression_type);
@@ -19,25 +39,14 @@ Token TokenFactory::create_token(std::string_view symbol, std::string_view ident
 }
 
 Symbol TokenFactory::string_to_symbol(std::string_view symbol_str) {
-    // Implement the conversion from string_view to Symbol enum
-    // Example:
-    // if (symbol_str == "decl_keyword") {
-    //   return Symbol::decl_keyword;
-    // }
+    // symbol_str is spelled like in a program, e.g. "as" or "::"
+    return symbolOf(grammar::keywordKind(symbol_str));
 }
 
 IdentifierType TokenFactory::string_to_identifier_type(std::string_view identifier_type_str) {
-    // Implement the conversion from string_view to IdentifierType enum
-    // Example:
-    // if (identifier_type_str == "identifier") {
-    //   return IdentifierType::identifier;
-    // }
+    return identifier_types.find(identifier_type_str);
 }
 
 ExpressionType TokenFactory::string_to_expression_type(std::string_view expression_type_str) {
-    // Implement the conversion from string_view to ExpressionType enum
-    // Example:
-    // if (expression_type_str == "declaration") {
-    //   return ExpressionType::declaration;
-    // }
+    return expression_types.find(expression_type_str);
 }
@@ -7,6 +7,8 @@
 
 #include <memory>
 #include <algorithm>
+#include <cstdint>
+#include <stdexcept>
 
 
 using namespace NAMESPACE::lexer;
@@ -17,212 +19,488 @@ Tokenizer::Tokenizer(const std::string_view program)
     _program_size = _program.size();
 }
 
-std::vector<Token> Tokenizer::tokenize() {
-    evaluate();
-    return _tokens;
+Tokenizer::Tokenizer(PaddedView program)
+        : Tokenizer(program.text()) {
+
+    _padded = true;
 }
 
-void Tokenizer::handle_whitespace(char c, std::vector<Token> &tokens) {
-    // Default implementation: do nothing with whitespace
+TokenStream Tokenizer::tokenize() {
+    return tokenize(_scratch);
 }
 
-bool Tokenizer::is_comment_start(char c, size_t index) {
-    // Implement the comment start detection logic
+TokenStream Tokenizer::tokenize(Scratch &scratch) {
+    _tokens = std::move(scratch.tokens);
+    handle_start();
+    evaluate(scratch);
+    return std::move(_tokens);
 }
 
-size_t Tokenizer::handle_comments(size_t index) {
-    // Implement comment handling logic
-    // Return the updated index after handling the comment
+TokenStream Tokenizer::retokenize(std::string_view program, const TokenStream &previous, const TextEdit &edit) {
+    return retokenize(program, false, previous, edit);
 }
 
-void Tokenizer::handle_token(char c, std::vector<Token> &tokens) {
-    // Default implementation: create a simple Token instance
-    // Override this method in derived classes for more complex token handling
-    Token token;
-    tokens.push_back(token);
+TokenStream Tokenizer::retokenize(PaddedView program, const TokenStream &previous, const TextEdit &edit) {
+    return retokenize(program.text(), true, previous, edit);
 }
 
-void Tokenizer::handle_start() {
-    _tokens.clear();
+TokenStream Tokenizer::retokenize(std::string_view program, bool padded, const TokenStream &previous,
+                                  const TextEdit &edit) {
+    const auto old_restarts = std::move(_restarts);
+    const auto old_docs = std::move(_doc_comments);
+    const auto old_diagnostics = std::move(_diagnostics);
+    const auto shift = static_cast<std::int64_t>(edit.inserted.size()) - static_cast<std::int64_t>(edit.removed);
+
+    auto shifted = [shift](SourceSpan span) {
+        return SourceSpan{static_cast<SourceOffset>(span.begin + shift), static_cast<SourceOffset>(span.end + shift)};
+    };
+
+    // the last restart point before the edit whose lookahead didn't reach it, the start of the program
+    // if there is none. A lexeme before the point can have looked far past it, an unclosed string up
+    // to the end of the program, and the edit can make it match differently.
+    auto after = std::partition_point(old_restarts.begin(), old_restarts.end(), [&](const RestartPoint &point) {
+        return point.offset < edit.offset && point.examined <= edit.offset;
+    });
+    auto start = after == old_restarts.begin() ? RestartPoint{} : *(after - 1);
+
+    if (start.tokens > previous.size() || start.docs > old_docs.size() ||
+        (!old_restarts.empty() && old_restarts.back().tokens > previous.size())) {
+        throw std::invalid_argument("previous isn't the token stream of the last tokenize call");
+    }
 
+    _program = program;
+    _program_size = program.size();
+    _padded = padded;
+    _lines_built = false;
+    handle_start();
+
+    // everything before the restart point is the same as before
+    _tokens.reserve(previous.size());
+    _tokens.append(previous, 0, start.tokens, 0);
+    for (std::size_t i = 0; i < start.docs; ++i) {
+        auto doc = old_docs[i];
+        doc.text = _program.substr(doc.span.begin + 2, doc.text.size());
+        _doc_comments.push_back(doc);
+    }
+    for (auto &diagnostic: old_diagnostics) {
+        if (diagnostic.span.end <= start.offset) {
+            _diagnostics.push_back(diagnostic);
+        }
+    }
+    _restarts.assign(old_restarts.begin(), after);
+    _current_index = start.offset;
+    _examined = start.examined;
+
+    // the first old restart point that can line up, it has to be past the removed bytes
+    const auto edit_end = static_cast<std::size_t>(edit.offset) + edit.inserted.size();
+    auto old = std::partition_point(after, old_restarts.end(), [&](const RestartPoint &point) {
+        return point.offset < static_cast<std::size_t>(edit.offset) + edit.removed;
+    });
+
+    auto seen = _restarts.size();
+    while (step(_scratch)) {
+        if (_restarts.size() == seen) {
+            continue;
+        }
+        seen = _restarts.size();
+
+        const auto point = _restarts.back();
+        if (point.offset < edit_end || old == old_restarts.end()) {
+            continue;
+        }
+
+        // a doc comment looks back over blank lines for a ')', those can't reach the edit
+        if (scan::spaceRun(_program.substr(edit_end, point.offset - edit_end)) == point.offset - edit_end) {
+            continue;
+        }
 
+        while (old != old_restarts.end() && old->offset + shift < point.offset) {
+            ++old;
+        }
+        if (old == old_restarts.end() || old->offset + shift != point.offset) {
+            continue;
+        }
+
+        // same state at the same text, the rest is previous shifted
+        _tokens.append(previous, old->tokens, previous.size(), shift);
+        for (auto i = old->docs; i < old_docs.size(); ++i) {
+            auto doc = old_docs[i];
+            doc.span = shifted(doc.span);
+            doc.text = _program.substr(doc.span.begin + 2, doc.text.size());
+            _doc_comments.push_back(doc);
+        }
+        for (auto &diagnostic: old_diagnostics) {
+            if (diagnostic.span.begin >= old->offset) {
+                _diagnostics.push_back({diagnostic.error, shifted(diagnostic.span)});
+            }
+        }
+        for (auto it = old + 1; it != old_restarts.end(); ++it) {
+            _restarts.push_back({static_cast<SourceOffset>(it->offset + shift), it->tokens - old->tokens + point.tokens,
+                                 it->docs - old->docs + point.docs,
+                                 std::max(static_cast<SourceOffset>(it->examined + shift), point.examined)});
+        }
+        break;
+    }
+
+    return std::move(_tokens);
 }
 
-void Tokenizer::evaluate() {
-    char c;
-    _current_line = 1;
-    _current_index = 0;
+TokenStream Tokenizer::feed(std::span<const char> chunk) {
+    if (!_streaming) {
+        startStream();
+    }
 
-    while (_current_index < _program_size && _current_index >= 0) {
-        c = _program[_current_index];
+    compactStream();
+    _stream.append(chunk.data(), chunk.size());
 
+    _program = _stream;
+    _program_size = _stream.size();
 
-#ifdef ENV_TEST
-        _char_history.push_back(c);
+    return drainStream();
+}
 
-        logger::trace("Current char: [{}]({}:{})", c, _current_line, _current_column);
-#endif
+TokenStream Tokenizer::finish() {
+    if (!_streaming) {
+        startStream();
+    }
 
-        if (c == '\n') {
-            switch (_current_direction) {
-                case TokenDirection::RIGHT:
-                    _current_line++;
-                    _prev_line_column = _current_column;
-                    _current_column = 0;
-                    break;
-                case TokenDirection::LEFT:
-                    _current_line--;
-                    _current_column = _prev_line_column;
-                    break;
-            }
+    // whatever is left is tokenized to the end
+    _stream_open = false;
+    auto tokens = drainStream();
 
-        } else {
-            switch (_current_direction) {
-                case TokenDirection::RIGHT:
-                    _current_column++;
-                    break;
-                case TokenDirection::LEFT:
-                    _current_column--;
-                    break;
-            }
-        }
+    _streaming = false;
+    _base = 0;
+    _program = _unstreamed;
+    _program_size = _unstreamed.size();
+    _padded = _unstreamed_padded;
+    _stream.clear();
 
-        // check if any rule on stack terminates on this character
-        auto terminated_rules = terminateStackRules(c);
+    return tokens;
+}
 
-        if (terminated_rules.size() > 0) {
-            logger::trace("Terminated rules [{}]({}:{}): {}", c, _current_line, _current_column, terminated_rules.size());
-        }
+void Tokenizer::startStream() {
+    handle_start();
 
-        auto rules = getRulesForChar(c);
+    _unstreamed = _program;
+    _unstreamed_padded = _padded;
 
-        if (rules.size() > 0) {
-            logger::trace("Rules for char [{}]({}:{}): {}", c, _current_line, _current_column, rules.size());
-        }
+    _streaming = true;
+    _stream_open = true;
+    _padded = false;
+    _lines_built = false;
+    _base = 0;
 
-        // add all rules that aren't terminated
-        for (auto &rule: rules) {
-            auto terminated = std::find_if(terminated_rules.begin(), terminated_rules.end(),
-                                           [&rule](const TokenRule &terminated) {
-                                               return terminated.name == rule->name;
-                                           });
+    _stream.clear();
+    _stream_docs.clear();
 
-            if (terminated == terminated_rules.end()) {
-                pushRule(rule);
-            }
-        }
+    _program = _stream;
+    _program_size = 0;
+}
 
-        // apply terminated rules
-        for (auto &rule: terminated_rules) {
-            applyRule(std::move(rule));
-        }
+void Tokenizer::compactStream() {
+    // an open rule still needs its text for its token
+    auto keep = _current_index;
+    for (auto &frame: _rule_stack) {
+        keep = std::min<std::size_t>(keep, frame.span.begin - _base);
+    }
 
-        if (_current_direction == TokenDirection::LEFT && _current_index == 0) {
+    // matchers look at the byte before the current one, isDocPosition back to the last byte that
+    // isn't a space or the second newline
+    int newlines = 0;
+    while (keep > 0 && newlines < 2) {
+        auto c = _stream[--keep];
+        if (c == '\n') {
+            newlines++;
+        } else if (!scan::isSpace(c)) {
             break;
         }
+    }
 
-        switch (_current_direction) {
-            case TokenDirection::RIGHT:
-                _current_index++;
-                break;
-            case TokenDirection::LEFT:
-                _current_index--;
-                break;
-        }
+    _stream.erase(0, keep);
+    _base += keep;
+    _current_index -= keep;
+    _examined = _examined > keep ? _examined - keep : 0;
+}
+
+TokenStream Tokenizer::drainStream() {
+    while (step(_scratch)) {}
+
+    // the text of a doc comment outlives the chunk it was in
+    for (auto i = _stream_docs.size(); i < _doc_comments.size(); ++i) {
+        _doc_comments[i].text = _stream_docs.emplace_back(_doc_comments[i].text);
+    }
+
+    auto tokens = std::move(_tokens);
+    _tokens.clear();
+    return tokens;
+}
+
+std::optional<TokenView> Tokenizer::next() {
+    if (!fill(1)) {
+        return std::nullopt;
     }
+
+    auto token = _ahead[_ahead_head];
+    _ahead_head = (_ahead_head + 1) % lookahead;
+    _ahead_count--;
+    return token;
 }
 
-void Tokenizer::registerRule(TokenRule &rule) {
-    logger::debug("Registering rule: {}", rule.name);
-    _rules.push_back(std::make_shared<TokenRule>(rule));
+std::optional<TokenView> Tokenizer::peek(std::size_t k) {
+    if (k >= lookahead) {
+        throw std::out_of_range("peek is limited to Tokenizer::lookahead tokens");
+    }
+
+    if (!fill(k + 1)) {
+        return std::nullopt;
+    }
+
+    return _ahead[(_ahead_head + k) % lookahead];
 }
 
-std::vector<std::shared_ptr<TokenRule>> Tokenizer::getRulesForChar(char c) {
-    std::vector<std::shared_ptr<TokenRule>> rules;
+bool Tokenizer::fill(std::size_t count) {
+    if (!_pulling) {
+        handle_start();
+        _pulling = true;
+    }
 
-    for (auto &rule: _rules) {
-        std::shared_ptr<TokenRule> r = nullptr;
-        if (rule->symbol.empty()) {
-            r = rule;
-        } else if (rule->symbol[0] == c) {
-            r = rule;
+    while (_ahead_count < count) {
+        if (_emitted < _tokens.size()) {
+            _ahead[(_ahead_head + _ahead_count) % lookahead] = _tokens[_emitted++];
+            _ahead_count++;
+            continue;
         }
 
-        if (r != nullptr && r->matcher != nullptr) {
-            if (!r->matcher(c, _current_index, _program)) {
-                r = nullptr;
-            }
+        if (_pull_done) {
+            return false;
         }
 
-        if (r != nullptr) {
-            rules.push_back(r);
-        }
+        // _tokens only ever holds the tokens of one step
+        _tokens.clear();
+        _emitted = 0;
+        _pull_done = !step(_scratch);
     }
 
-    return std::move(rules);
+    return true;
 }
 
-std::vector<TokenRule> Tokenizer::terminateStackRules(char c) {
-    std::vector<TokenRule> rules;
+void Tokenizer::handle_whitespace(char c, TokenStream &tokens) {
+    // Default implementation: do nothing with whitespace
+}
 
-    while (!_rule_stack.empty()) {
-        auto &rule = _rule_stack.top();
+bool Tokenizer::is_comment_start(char c, size_t index) {
+    if (index + 1 >= _program_size || _program[index + 1] != '-') {
+        return false;
+    }
 
-        if (rule.terminator[0] == c) {
-            _rule_stack.pop();
+    return c == '-' || c == '!';
+}
 
-            switch (rule.direction) {
-                case TokenDirection::RIGHT:
-                    rule.location.line_end = _current_line;
-                    rule.location.column_end = _current_column;
-                    break;
-                case TokenDirection::LEFT:
-                    rule.location.line_start = _current_line;
-                    rule.location.column_start = _current_column;
-                    break;
-            }
+size_t Tokenizer::handle_comments(size_t index) {
+    const bool block = _program[index] == '!';
+    const size_t body = index + 2;
+
+    size_t body_end;
+    size_t end;
+    if (block) {
+        body_end = _padded ? scan::findPair(PaddedView::assume(_program), '-', '!', body)
+                           : scan::findPair(_program, '-', '!', body);
+        end = std::min<size_t>(body_end + 2, _program_size);
+    } else {
+        body_end = scan::findByte(_program, '\n', body);
+        end = body_end;
+    }
 
-            rules.push_back(rule);
-        } else {
-            break;
+    if (isDocPosition(index)) {
+        _doc_comments.push_back({_program.substr(body, body_end - body), {offsetAt(index), offsetAt(end)}});
+    }
+
+    return end;
+}
+
+bool Tokenizer::isDocPosition(size_t index) const {
+    int newlines = 0;
+
+    for (auto i = index; i > 0; --i) {
+        auto c = _program[i - 1];
+        if (c == '\n') {
+            if (++newlines > 1) {
+                return false;
+            }
+        } else if (!scan::isSpace(c)) {
+            return c == ')' && newlines == 1;
         }
     }
 
-    return std::move(rules);
+    return false;
+}
+
+void Tokenizer::handle_token(char c, TokenStream &tokens) {
+    // Default implementation: create a simple Token instance
+    // Override this method in derived classes for more complex token handling
+    Token token;
+    tokens.push_back(token);
+}
+
+void Tokenizer::pushNumber(TokenStream &tokens, SourceSpan span) {
+    const auto number = decodeNumber(_program.substr(span.begin - _base, span.size()));
+    if (number.overflow) {
+        _diagnostics.push_back({LexErrorCode::number_overflow, span});
+    }
+    tokens.pushNumber(span, number);
 }
 
-void Tokenizer::pushRule(std::shared_ptr<TokenRule> rule) {
-    logger::debug("Pushing rule: {}", rule->name);
+void Tokenizer::handle_start() {
+    _tokens.clear();
+    _rule_stack.clear();
+    _doc_comments.clear();
+    _restarts.clear();
+    _diagnostics.clear();
 
+    _current_index = 0;
+    _examined = 0;
 
-    _current_direction = rule->direction;
+    _prepared = false;
+    _last_seen.fill(0);
 
-    CodeLocation location = {0, 0, 0, 0};
+    _layout_pending = false;
+    _indents.clear();
 
-    switch (rule->direction) {
-        case TokenDirection::RIGHT:
-            location = {_current_line, _current_column, 0, 0};
-            break;
-        case TokenDirection::LEFT:
-            location = {0, 0, _current_line, _current_column};
-            break;
+    _ahead_head = 0;
+    _ahead_count = 0;
+    _emitted = 0;
+    _pulling = false;
+    _pull_done = false;
+}
+
+const LineIndex &Tokenizer::lines() {
+    if (!_lines_built) {
+        _lines = LineIndex(_program);
+        _lines_built = true;
+    }
+    return _lines;
+}
+
+bool Tokenizer::streamedRunOpen() const {
+    const auto left = _program_size - _current_index;
+    return std::any_of(_fixed_runs.begin(), _fixed_runs.end(), [&](scan::CharClass run) {
+        return scan::run(run, _program.data() + _current_index, left) == left;
+    });
+}
+
+void Tokenizer::skipRun(scan::CharClass run) {
+    if (run == scan::CharClass::none || _current_index >= _program_size) {
+        return;
+    }
+
+    auto length = runAt(run, _current_index);
+    if (length == 0) {
+        return;
+    }
+
+#ifdef ENV_TEST
+    if (_debug_history) {
+        _char_history.insert(_char_history.end(), _program.begin() + _current_index,
+                             _program.begin() + _current_index + length);
     }
+#endif
 
-    _rule_stack.push(rule->clone(location));
+    _current_index += length;
+}
+
+void Tokenizer::skipUntil(char c) {
+    if (_current_index >= _program_size) {
+        return;
+    }
+
+    const auto end = scan::findByte(_program.substr(0, _program_size), c, _current_index);
 
 #ifdef ENV_TEST
-    _rule_stack_history.push_back(&_rule_stack.top());
+    if (_debug_history) {
+        _char_history.insert(_char_history.end(), _program.begin() + _current_index, _program.begin() + end);
+    }
 #endif
 
+    _current_index = end;
+}
+
+std::size_t Tokenizer::runAt(scan::CharClass run, std::size_t index) const {
+    return _padded ? scan::paddedRun(run, _program.data() + index)
+                   : scan::run(run, _program.data() + index, _program_size - index);
+}
+
+void Tokenizer::closeIndents() {
+    for (std::size_t i = 0; i < _indents.size(); ++i) {
+        _tokens.push(TokenKind::dedent, {offsetAt(_program_size), offsetAt(_program_size)});
+    }
+    _indents.clear();
+}
+
+void Tokenizer::trackLeft(std::size_t from, std::size_t to) {
+    const auto text = _program.substr(from, to - from);
+
+    // only the last one in the bytes the step moved over counts
+    for (auto byte: _left_bytes) {
+        auto found = text.rfind(static_cast<char>(byte));
+        if (found != std::string_view::npos) {
+            _last_seen[byte] = offsetAt(from + found) + 1;
+        }
+    }
+}
+
+void Tokenizer::evaluate(Scratch &scratch) {
+    evaluateRules(_rules, scratch);
 }
 
-void Tokenizer::applyRule(TokenRule &&rule) {
-    logger::debug("Applying rule: {}", rule.name);
+bool Tokenizer::step(Scratch &scratch) {
+    return stepRules(_rules, scratch);
+}
+
+RuleInfo Tokenizer::ruleInfo(RuleId id) const {
+    return _rules.info(id);
+}
+
+void Tokenizer::registerRule(TokenRule &rule) {
+    logger::debug("Registering rule: {}", rule.name);
+
+    _rules.add(rule);
 }
 
+RuleId RuleSet::add(TokenRule &rule) {
+    auto id = static_cast<RuleId>(_rules.size());
+    rule.id = id;
+    _rules.push_back(rule);
 
+    if (rule.symbol.empty()) {
+        _wildcard_rules.push_back(id);
+    } else {
+        _rules_by_char[static_cast<unsigned char>(rule.symbol[0])].push_back(id);
+    }
+
+    return id;
+}
 
+void RuleSet::candidates(char c, std::size_t index, std::string_view &program, std::vector<RuleId> &rules) const {
+    const auto &dispatched = _rules_by_char[static_cast<unsigned char>(c)];
 
+    // both lists are sorted by registration, merge them so rules are still visited in that order
+    auto d = dispatched.begin();
+    auto w = _wildcard_rules.begin();
 
+    while (d != dispatched.end() || w != _wildcard_rules.end()) {
+        RuleId id;
+        if (w == _wildcard_rules.end() || (d != dispatched.end() && *d < *w)) {
+            id = *d++;
+        } else {
+            id = *w++;
+        }
 
+        auto &rule = _rules[id];
 
+        if (rule.matcher != nullptr && !rule.matcher(c, index, program)) {
+            continue;
+        }
+
+        rules.push_back(id);
+    }
+}
@@ -6,11 +6,14 @@
 
 using namespace NAMESPACE;
 
-std::pair<unsigned long, unsigned long> NAMESPACE::contegiousText(std::string_view text, unsigned long start_index) {
-    unsigned long start = start_index;
-    unsigned long end = start_index;
+std::pair<std::size_t, std::size_t> NAMESPACE::contegiousText(std::string_view text, std::size_t start_index) {
+    std::size_t start = start_index;
+    std::size_t end = start_index;
 
-    // left
+    // left, an index past the end starts from the last character
+    if (start >= text.size()) {
+        start = text.empty() ? 0 : text.size() - 1;
+    }
     while (start > 0 && text[start] != ' ') {
         start--;
     }
@@ -20,9 +23,9 @@ std::pair<unsigned long, unsigned long> NAMESPACE::contegiousText(std::string_vi
         end++;
     }
 
-    // special case
-    if (text[start] == ' ') start++;
-    if (text[end] == ' ') end--;
+    // special case, end is text.size() if the word runs to the end of the text
+    if (start < text.size() && text[start] == ' ') start++;
+    if (end < text.size() && text[end] == ' ') end--;
 
     return {start, end};
 }
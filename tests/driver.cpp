@@ -0,0 +1,109 @@
+#include "include/test.h"
+#include "../include/driver.h"
+#include "../include/thread_pool.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+
+using namespace NAMESPACE;
+
+
+static test::suite _ = [] {
+
+
+    using namespace test;
+    using namespace test::spec;
+
+
+    describe("thread pool") = [] {
+
+        it("should run submitted tasks and return their results") = [] {
+            ThreadPool pool(4);
+
+            std::vector<std::future<int>> results;
+            for (int i = 0; i < 100; ++i) {
+                results.push_back(pool.submit([i] { return i * i; }));
+            }
+
+            for (int i = 0; i < 100; ++i) {
+                expect(results[i].get() == i * i);
+            }
+            expect(pool.size() == 4_i);
+        };
+
+        it("should run tasks submitted by tasks") = [] {
+            std::atomic<int> count = 0;
+
+            {
+                ThreadPool pool(3);
+                for (int i = 0; i < 10; ++i) {
+                    pool.submit([&] {
+                        for (int j = 0; j < 10; ++j) {
+                            pool.submit([&] { count++; });
+                        }
+                    });
+                }
+            }
+
+            // the destructor finishes every task first
+            expect(count.load() == 100_i);
+        };
+
+        it("should pass exceptions through the future") = [] {
+            ThreadPool pool(1);
+            auto result = pool.submit([]() -> int { throw std::runtime_error("task failed"); });
+
+            expect(throws<std::runtime_error>([&] { result.get(); }));
+        };
+    };
+
+
+    describe("driver") = [] {
+
+        it("should lex every source file in a stable order") = [] {
+            auto root = std::filesystem::temp_directory_path() / "rara-driver-test";
+            std::filesystem::remove_all(root);
+            std::filesystem::create_directories(root / "nested");
+
+            std::ofstream(root / "b.ra") << "a :: 2 ";
+            std::ofstream(root / "a.ra") << "b as 1 \nc = \"three\"!";
+            std::ofstream(root / "nested" / "c.ra") << "";
+            std::ofstream(root / "notes.txt") << "not a source";
+
+            auto files = driver::findSources(root);
+            expect(files.size() == 3_i);
+
+            ThreadPool pool(2);
+            auto names = lexer::Interner::concurrent();
+            auto results = driver::buildFiles(files, pool, &names);
+
+            expect(results.size() == 3_i);
+            expect(results[0].path.filename() == "a.ra");
+            expect(results[0].tokens == 7_i);
+            expect(results[1].path.filename() == "b.ra");
+            expect(results[1].tokens == 3_i);
+            expect(results[1].bytes == 7_i);
+            expect(results[2].tokens == 0_i);
+
+            for (auto &result: results) {
+                expect(result.error.empty());
+            }
+
+            // a, b and c
+            expect(names.size() == 3_i);
+
+            std::filesystem::remove_all(root);
+        };
+
+        it("should reject bad arguments") = [] {
+            std::vector<std::string_view> missing_jobs{"src", "-j"};
+            std::vector<std::string_view> zero_jobs{"src", "-j0"};
+
+            expect(driver::build({}) == 2_i);
+            expect(driver::build(missing_jobs) == 2_i);
+            expect(driver::build(zero_jobs) == 2_i);
+        };
+    };
+
+};
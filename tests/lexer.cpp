@@ -0,0 +1,159 @@
+#include "include/test.h"
+#include "../include/lexer.h"
+#include "../include/source_file.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace NAMESPACE;
+
+
+static test::suite _ = [] {
+
+
+    using namespace test;
+    using namespace test::spec;
+
+
+    describe("lexer") = [] {
+
+        it("should tokenize a declaration") = [] {
+            auto l1 = lexer::Lexer{"a :: 2"};
+            auto tokens = l1.tokenize();
+            auto lines = lexer::LineIndex{"a :: 2"};
+
+            expect(tokens.size() == 3_i);
+            expect(tokens[0].kind == lexer::TokenKind::identifier);
+            expect(tokens[1].kind == lexer::TokenKind::decl_keyword);
+            expect(tokens[2].kind == lexer::TokenKind::number);
+
+            expect(test::eq(lines.resolve(tokens[0].span).toString(), std::string("(1:1)-(1:1)")));
+            expect(test::eq(lines.resolve(tokens[1].span).toString(), std::string("(1:3)-(1:4)")));
+            expect(test::eq(lines.resolve(tokens[2].span).toString(), std::string("(1:6)-(1:6)")));
+            expect(tokens.number(2)->integer == 2);
+        };
+
+        it("should tokenize 'as' as a declaration") = [] {
+            auto l1 = lexer::Lexer{"b as 1"};
+            auto tokens = l1.tokenize();
+
+            expect(tokens.size() == 3_i);
+            expect(tokens[1].kind == lexer::TokenKind::decl_keyword);
+            expect(tokens[1].identifierType() == lexer::IdentifierType::token);
+        };
+
+        it("should tokenize a reassignment") = [] {
+            auto l1 = lexer::Lexer{"a = \"three\"!"};
+            auto tokens = l1.tokenize();
+
+            expect(tokens.size() == 4_i);
+            expect(tokens[0].kind == lexer::TokenKind::identifier);
+            expect(tokens[1].kind == lexer::TokenKind::assign);
+            expect(tokens[2].kind == lexer::TokenKind::string);
+            expect(tokens[3].kind == lexer::TokenKind::bang);
+        };
+
+        it("should emit words and numbers where they end, in source order") = [] {
+            using K = lexer::TokenKind;
+
+            auto kinds = [](std::string program) {
+                std::vector<K> kinds;
+                for (auto token: lexer::Lexer{std::move(program)}.tokenize()) {
+                    kinds.push_back(token.kind);
+                }
+                return kinds;
+            };
+
+            expect(kinds("a::2") == std::vector{K::identifier, K::decl_keyword, K::number});
+            expect(kinds("return 1") == std::vector{K::return_keyword, K::number});
+            expect(kinds("f :: (a: int)\n    return a") ==
+                   std::vector{K::identifier, K::decl_keyword, K::paren_open, K::identifier, K::colon, K::identifier,
+                               K::paren_close, K::indent, K::return_keyword, K::identifier, K::dedent});
+
+            // spans hold the word or the digits only
+            std::string_view program = "a :: 2\nb = c!";
+            auto tokens = lexer::Lexer{std::string(program)}.tokenize();
+            auto lines = lexer::LineIndex{program};
+            expect(tokens.size() == 7_i);
+            expect(test::eq(lines.resolve(tokens[2].span).toString(), std::string("(1:6)-(1:6)")));
+            expect(test::eq(lines.resolve(tokens[5].span).toString(), std::string("(2:5)-(2:5)")));
+        };
+
+        it("should lex a source file without copying it") = [] {
+            auto path = std::filesystem::temp_directory_path() / "rara-lexer-test.ra";
+            std::ofstream(path, std::ios::binary) << "a :: 2\nb as 1";
+
+            {
+                auto file = SourceFile::open(path);
+                expect(file.mapped());
+                expect(file.text() == std::string_view("a :: 2\nb as 1"));
+
+                // moving keeps the mapping
+                auto moved = std::move(file);
+                auto l1 = lexer::Lexer{moved};
+                auto tokens = l1.tokenize();
+
+                expect(tokens.size() == 6_i);
+                expect(tokens[3].span.begin == 7_i);
+            }
+
+            std::filesystem::remove(path);
+            expect(throws<std::system_error>([&] { SourceFile::open(path); }));
+        };
+
+        it("should pad mapped files that fill their last page") = [] {
+            auto path = std::filesystem::temp_directory_path() / "rara-lexer-page.ra";
+            std::ofstream(path, std::ios::binary) << std::string(4096, 'a');
+
+            {
+                auto file = SourceFile::open(path);
+                expect(file.size() == 4096_i);
+
+                auto padded = file.padded();
+                for (std::size_t i = 0; i < lexer::padding; ++i) {
+                    expect(padded.data()[padded.size() + i] == '\0');
+                }
+            }
+
+            std::filesystem::remove(path);
+        };
+
+        it("should read streams into an owned buffer") = [] {
+            std::istringstream input("a :: 2");
+
+            auto file = SourceFile::read(input);
+            auto moved = std::move(file);
+            expect(!moved.mapped());
+            expect(moved.text() == std::string_view("a :: 2"));
+            expect(lexer::Lexer{moved}.tokenize().size() == 3_i);
+        };
+
+        it("should stay padded when empty or moved from") = [] {
+            auto zeros = [](const SourceFile &file) {
+                auto padded = file.padded();
+                for (std::size_t i = 0; i < lexer::padding; ++i) {
+                    if (padded.data()[padded.size() + i] != '\0') {
+                        return false;
+                    }
+                }
+                return padded.size() == 0;
+            };
+
+            SourceFile empty;
+            expect(zeros(empty));
+
+            SourceFile moved;
+            moved = std::move(empty);
+            expect(zeros(moved));
+            expect(zeros(empty));
+
+            std::istringstream input("a :: 2");
+            auto file = SourceFile::read(input);
+            file = SourceFile();
+            expect(zeros(file));
+            expect(lexer::Lexer{file}.tokenize().size() == 0_i);
+        };
+    };
+
+};
@@ -2,11 +2,104 @@
 // Created by Pew on 20-04-2023.
 //
 #include "include/test.h"
+#include "../include/lexer.h"
+#include "../include/thread_pool.h"
+#include "../include/tokenizer/fsm_tokenizer.h"
+#include "../include/tokenizer/grammar.h"
+#include "../include/tokenizer/interner.h"
+#include "../include/tokenizer/parallel.h"
+#include "../include/tokenizer/regex_tokenizer.h"
+#include "../include/tokenizer/scan.h"
+#include "../include/tokenizer/string_literal.h"
+#include "../include/tokenizer/token_factory.h"
 #include "../include/tokenizer/tokenizer.h"
 #include "../include/utility.h"
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <type_traits>
+
 using namespace NAMESPACE;
 
+// Count every heap allocation made by the test binary, used to check that lexing doesn't allocate
+
+static std::atomic<std::size_t> allocation_count = 0;
+
+static void *countedAlloc(std::size_t size, std::size_t alignment = 0) {
+    allocation_count++;
+    // aligned_alloc wants a size that is a multiple of the alignment
+    auto p = alignment == 0 ? std::malloc(size)
+                            : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new(std::size_t size) {
+    return countedAlloc(size);
+}
+
+void *operator new[](std::size_t size) {
+    return countedAlloc(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+// Builds the TokenRule equivalent of a static rule type
+template<class R>
+lexer::TokenRule dynamicRule() {
+    auto rule = lexer::TokenRule{R::name, R::symbol, R::terminator};
+    rule.direction = R::direction;
+    rule.kind = R::kind;
+    rule.opaque = R::opaque;
+    rule.run = R::run;
+    rule.matcher = [](char c, unsigned long idx, std::string_view &program) {
+        return R::match(c, idx, program);
+    };
+    return rule;
+}
+
 
 static test::suite _ = [] {
 
@@ -40,7 +133,7 @@ static test::suite _ = [] {
             auto &stack_history = t1._rule_stack_history;
             expect(stack_history.size() == 1_i);
             auto r = stack_history[0];
-            auto c = r->location.toString();
+            auto c = t1.lines().resolve(r->span).toString();
             auto ce = "(1:1)-(1:13)";
             expect(test::eq(c, ce));
 
@@ -59,13 +152,14 @@ static test::suite _ = [] {
             auto stack = t1.debugRuleStack();
             expect(stack.size() == 0_i);
 
+            // the loop never walks back over the program
             auto &char_history = t1._char_history;
-            expect(_ul(char_history.size()) == _ul(program.size() * 2 - 1));
+            expect(_ul(char_history.size()) == _ul(program.size()));
 
             auto &stack_history = t1._rule_stack_history;
             expect(stack_history.size() == 1_i);
             auto r = stack_history[0];
-            auto c = r->location.toString();
+            auto c = t1.lines().resolve(r->span).toString();
             auto ce = "(1:1)-(1:13)";
             expect(test::eq(c, ce));
 
@@ -73,6 +167,30 @@ static test::suite _ = [] {
         };
 
 
+        it("should close repeated backwards rules in one pass") = [] {
+            std::string program;
+            for (int i = 0; i < 100; ++i) {
+                program += "'a b\" ";
+            }
+            program += "c\" ";
+
+            auto t1 = lexer::Tokenizer{program};
+            auto r1 = lexer::TokenRule{"qouted string", "\"", "'"};
+            r1.direction = lexer::TokenDirection::LEFT;
+            r1.kind = lexer::TokenKind::string;
+            t1.registerRule(r1);
+
+            auto tokens = t1.tokenize();
+            expect(_ul(t1._char_history.size()) == _ul(program.size()));
+
+            // the last one reaches back to the quote of the one before
+            expect(tokens.size() == 101_i);
+            expect(tokens[0].span == lexer::SourceSpan{0, 5});
+            expect(tokens[99].span == lexer::SourceSpan{594, 599});
+            expect(tokens[100].span == lexer::SourceSpan{594, 602});
+        };
+
+
         it("should be able to handle the identifier in a :: 2") = [] {
             std::string_view program = "a :: 2";
             auto t1 = lexer::Tokenizer{program};
@@ -100,12 +218,1237 @@ static test::suite _ = [] {
             auto &stack_history = t1._rule_stack_history;
             expect(stack_history.size() == 1_i);
             auto r = stack_history[0];
-            auto c = r->location.toString();
+            auto c = t1.lines().resolve(r->span).toString();
             auto ce = "(1:1)-(1:2)";
             expect(test::eq(c, ce));
 
             expect(tokens.size() == 0_i);
         };
+
+        it("should only try rules that can start on the current character") = [] {
+            std::string_view program = "(a) (b)";
+            auto t1 = lexer::Tokenizer{program};
+
+            int paren_calls = 0;
+            int wildcard_calls = 0;
+
+            auto r1 = lexer::TokenRule{"paren", "(", ")"};
+            r1.matcher = [&paren_calls](char c, unsigned long idx, std::string_view program) {
+                paren_calls++;
+                return true;
+            };
+
+            auto r2 = lexer::TokenRule{"identifier", "", " "};
+            r2.matcher = [&wildcard_calls](char c, unsigned long idx, std::string_view program) {
+                wildcard_calls++;
+                return false;
+            };
+
+            t1.registerRule(r1);
+            t1.registerRule(r2);
+
+            t1.tokenize();
+
+            expect(paren_calls == 2_i);
+            expect(_ul(wildcard_calls) == _ul(program.size()));
+
+            auto &stack_history = t1._rule_stack_history;
+            expect(stack_history.size() == 2_i);
+        };
+
+        it("should not allocate per character once the scratch buffers have grown") = [] {
+            std::string program;
+            for (int i = 0; i < 1000; ++i) {
+                program += "a :: \"hello world\" (b c)\n";
+            }
+
+            auto t1 = lexer::Tokenizer{program};
+            t1._debug_history = false;
+
+            auto r1 = lexer::TokenRule{"qouted string", "\"", "\""};
+            r1.kind = lexer::TokenKind::string;
+            auto r2 = lexer::TokenRule{"paren", "(", ")"};
+            auto r3 = lexer::TokenRule{"identifier", "", " "};
+            r3.kind = lexer::TokenKind::identifier;
+            r3.matcher = [](char c, unsigned long, std::string_view) {
+                return std::isalpha(c) || c == '_';
+            };
+
+            t1.registerRule(r1);
+            t1.registerRule(r2);
+            t1.registerRule(r3);
+
+            lexer::Tokenizer::Scratch scratch;
+
+            // first pass grows the buffers, its tokens are handed back for the second one
+            auto first = t1.tokenize(scratch);
+            const auto count = first.size();
+            scratch.tokens = std::move(first);
+
+            auto before = allocation_count.load();
+            auto tokens = t1.tokenize(scratch);
+            auto after = allocation_count.load();
+
+            expect(_ul(after - before) == _ul(0));
+            expect(tokens.size() > 1000_ul);
+            expect(_ul(tokens.size()) == _ul(count));
+        };
+    };
+
+
+    describe("static tokenizer") = [] {
+
+        it("should produce the same tokens as a tokenizer with the same rules") = [] {
+            using namespace lexer::grammar;
+
+            std::string_view program = "a :: 2\nb as \"hello (world)\"\nfoo : int : (a: int, b: int)\n    return 1\nc = 3 !";
+
+            auto t1 = lexer::Tokenizer{program};
+            auto rules = std::vector{
+                    dynamicRule<QuotedString>(), dynamicRule<DeclOp>(), dynamicRule<As>(), dynamicRule<Return>(),
+                    dynamicRule<Mutable>(), dynamicRule<Identifier>(), dynamicRule<Number>(), dynamicRule<Colon>(),
+                    dynamicRule<Assign>(), dynamicRule<Bang>(), dynamicRule<Question>(), dynamicRule<ParenOpen>(),
+                    dynamicRule<ParenClose>(), dynamicRule<Comma>()
+            };
+            for (auto &rule: rules) {
+                t1.registerRule(rule);
+            }
+            t1.setLayout(true);
+
+            auto t2 = MaraTokenizer{program};
+
+            auto dynamic_tokens = t1.tokenize();
+            auto static_tokens = t2.tokenize();
+
+            expect(dynamic_tokens.size() > 0_i);
+            expect(dynamic_tokens == static_tokens);
+
+            auto &char_history = t2._char_history;
+            expect(t1._char_history == char_history);
+        };
+
+        it("should match a fixed rule over its whole symbol") = [] {
+            std::string_view program = "a::2";
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto tokens = t1.tokenize();
+
+            expect(tokens.size() == 3_i);
+            expect(tokens[0].kind == lexer::TokenKind::identifier);
+            expect(tokens[1].kind == lexer::TokenKind::decl_keyword);
+            expect(tokens[1].symbol() == lexer::Symbol::decl_keyword);
+            expect(tokens[2].kind == lexer::TokenKind::number);
+            expect(test::eq(t1.lines().resolve(tokens[1].span).toString(), std::string("(1:2)-(1:3)")));
+
+            // the second ':' is skipped
+            expect(_ul(t1._char_history.size()) == _ul(program.size() - 1));
+        };
+
+        it("should skip identifier and number runs without changing tokens") = [] {
+            using namespace lexer::grammar;
+
+            std::string_view program = "a_rather_long_identifier_name_for_a_value :: 1234567890123456789012345678901234567\n"
+                                       "b as \"hello (world)\"\nreturn a_rather_long_identifier_name_for_a_value";
+
+            auto t1 = MaraTokenizer{program};
+            auto tokens = t1.tokenize();
+
+            // a run ends before the byte after it, tokens come out in the order of the program
+            expect(tokens.size() == 8_i);
+            expect(tokens == MaraTableTokenizer{program}.tokenize());
+            expect(test::eq(t1.lines().resolve(tokens[0].span).toString(), std::string("(1:1)-(1:41)")));
+            expect(test::eq(t1.lines().resolve(tokens[1].span).toString(), std::string("(1:43)-(1:44)")));
+
+            // only the first byte of a run is looked at
+            auto &history = t1._char_history;
+            expect(std::find(history.begin(), history.end(), 'v') == history.end());
+            expect(std::find(history.begin(), history.end(), '9') == history.end());
+        };
+    };
+
+
+    describe("line index") = [] {
+
+        it("should resolve offsets to lines and columns") = [] {
+            std::string_view program = "ab\n\ncd\n";
+            auto lines = lexer::LineIndex{program};
+
+            expect(_ul(lines.lines()) == 4_ul);
+
+            auto a = lines.resolve(0);
+            expect(a.line == 1_i && a.column == 1_i);
+
+            // a newline belongs to the line it ends
+            auto newline = lines.resolve(2);
+            expect(newline.line == 1_i && newline.column == 3_i);
+
+            auto empty = lines.resolve(3);
+            expect(empty.line == 2_i && empty.column == 1_i);
+
+            auto d = lines.resolve(5);
+            expect(d.line == 3_i && d.column == 2_i);
+
+            expect(test::eq(lines.resolve(lexer::SourceSpan{4, 6}).toString(), std::string("(3:1)-(3:2)")));
+        };
+
+        it("should keep tokens small") = [] {
+            // two 64 bit offsets, the flags and the kind
+            expect(_ul(sizeof(lexer::Token)) <= 32_ul);
+        };
+    };
+
+
+    describe("token stream") = [] {
+
+        it("should store kinds, offsets and lengths apart") = [] {
+            std::string_view program = "a :: 2\nb = 3!";
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto tokens = t1.tokenize();
+
+            expect(tokens.size() == 7_i);
+            expect(_ul(tokens.kinds().size()) == _ul(tokens.size()));
+            expect(tokens.kind(1) == lexer::TokenKind::decl_keyword);
+            expect(tokens.offsets()[1] == 2_i);
+            expect(tokens.lengths()[1] == 2_i);
+
+            // iteration yields the same views as indexing
+            std::size_t i = 0;
+            for (auto token: tokens) {
+                expect(token == tokens[i]);
+                i++;
+            }
+            expect(_ul(i) == _ul(tokens.size()));
+            expect(_ul(tokens.end() - tokens.begin()) == _ul(tokens.size()));
+
+            auto token = tokens[1].token();
+            expect(token.symbol == lexer::Symbol::decl_keyword);
+            expect(token.span == tokens[1].span);
+        };
+
+        it("should keep offsets past 4 GiB") = [] {
+            lexer::TokenStream tokens;
+            tokens.push(lexer::TokenKind::string, {5'000'000'000, 5'000'000'010});
+
+            expect(tokens[0].span.begin == 5'000'000'000_ull);
+            expect(tokens[0].span.size() == 10_i);
+
+            // a length that doesn't fit isn't cut off
+            expect(throws<std::length_error>([&] { tokens.push(lexer::TokenKind::string, {0, 5'000'000'000}); }));
+            expect(tokens.size() == 1_i);
+        };
+
+        it("should move the stream out of the tokenizer") = [] {
+            std::string_view program = "a :: 2";
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto first = t1.tokenize();
+            auto second = t1.tokenize();
+
+            expect(first.size() == 3_i);
+            expect(first == second);
+        };
+
+        it("should pull the same tokens as tokenize") = [] {
+            std::string_view program = "-- comment\nfoo : int : (a: int, b: int)\n    a = \"-- text\"!\n    return a, 42";
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto t2 = lexer::grammar::MaraTableTokenizer{program};
+            auto tokens = t1.tokenize();
+
+            lexer::TokenStream pulled;
+            while (auto token = t1.next()) {
+                pulled.push(*token);
+            }
+            expect(tokens.size() > 10_i);
+            expect(pulled == tokens);
+            expect(!t1.next().has_value());
+
+            lexer::TokenStream table;
+            while (auto token = t2.next()) {
+                table.push(*token);
+            }
+            expect(table == t2.tokenize());
+
+            // a stream without the values isn't the same
+            lexer::TokenStream bare;
+            for (auto token: tokens) {
+                bare.push(token.kind, token.span);
+            }
+            expect(!(bare == tokens));
+        };
+
+        it("should peek without consuming") = [] {
+            auto l1 = lexer::Lexer{"a :: 2"};
+            auto t1 = l1.tokenizer();
+
+            expect(t1.peek(2)->kind == lexer::TokenKind::number);
+            expect(t1.peek()->kind == lexer::TokenKind::identifier);
+            expect(!t1.peek(3).has_value());
+
+            expect(t1.next()->kind == lexer::TokenKind::identifier);
+            expect(t1.peek()->kind == lexer::TokenKind::decl_keyword);
+            expect(t1.next()->kind == lexer::TokenKind::decl_keyword);
+            expect(t1.peek()->number->integer == 2);
+            auto number = t1.next();
+            expect(number->kind == lexer::TokenKind::number && number->number->integer == 2);
+            expect(!t1.next().has_value());
+            expect(!t1.peek().has_value());
+
+            expect(throws<std::out_of_range>([&] { t1.peek(lexer::Tokenizer::lookahead); }));
+        };
+    };
+
+
+    describe("comments") = [] {
+
+        it("should skip comments without matching rules") = [] {
+            std::string_view program = "-- banner --\na :: 2 -- trailing\n!- a :: 3\nb :: 4 -!\nc :: \"-- not a comment\"";
+            std::string_view stripped = "a :: 2\nc :: \"-- not a comment\"";
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto t2 = lexer::grammar::MaraTokenizer{stripped};
+
+            auto tokens = t1.tokenize();
+            auto expected = t2.tokenize();
+
+            expect(_ul(tokens.size()) == _ul(expected.size()));
+            for (std::size_t i = 0; i < tokens.size() && i < expected.size(); ++i) {
+                expect(tokens[i].kind == expected[i].kind);
+            }
+
+            // lines of block comments are still counted
+            expect(test::eq(t1.lines().resolve(tokens.back().span).toString(), std::string("(5:6)-(5:23)")));
+
+            // no comment byte is looked at, the string is
+            for (auto c: t1._char_history) {
+                expect(c != 'b' && c != '3');
+            }
+            expect(t1.docComments().empty());
+        };
+
+        it("should return doc comments under a function header") = [] {
+            std::string_view program = "foo : int : (a: int, b: int)\n    !-\n    function doc\n    -!\n    body\n"
+                                       "bar :int: (a: int)\n    -- single line doc\n    -- not a doc\n    body\n"
+                                       "-- not a doc either\n";
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            t1.tokenize();
+
+            auto &docs = t1.docComments();
+            expect(docs.size() == 2_i);
+            expect(docs[0].text == std::string_view("\n    function doc\n    "));
+            expect(test::eq(t1.lines().resolve(docs[0].span).toString(), std::string("(2:5)-(4:6)")));
+            expect(docs[1].text == std::string_view(" single line doc"));
+            expect(test::eq(t1.lines().resolve(docs[1].span).toString(), std::string("(7:5)-(7:22)")));
+
+            // spans point into the program
+            expect(docs[1].text.data() > program.data() && docs[1].text.data() < program.data() + program.size());
+        };
+
+        it("should find comment ends past a vector") = [] {
+            using namespace lexer::scan;
+
+            std::string text = std::string(70, '-') + "!" + std::string(10, 'x');
+            expect(_ul(findPair(text, '-', '!')) == 69_ul);
+            expect(_ul(findPair(text, '-', '!', 70)) == _ul(text.size()));
+            expect(_ul(findByte("ab\ncd", '\n')) == 2_ul);
+            expect(_ul(findByte("ab", '\n')) == 2_ul);
+        };
     };
 
+
+    describe("layout") = [] {
+
+        // Only the indent and dedent tokens of tokens
+        auto layout = [](const lexer::TokenStream &tokens) {
+            std::vector<lexer::TokenView> layout;
+            for (auto token: tokens) {
+                if (token.kind == lexer::TokenKind::indent || token.kind == lexer::TokenKind::dedent) {
+                    layout.push_back(token);
+                }
+            }
+            return layout;
+        };
+
+        it("should emit indents and dedents around function bodies") = [&] {
+            std::string_view program = "foo : int : (a: int)\n    !-\n    doc\n    -!\n    body\n\n"
+                                       "  -- not code\n    if\n        deeper\n    return 1\nbar :: 2";
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto tokens = layout(t1.tokenize());
+
+            using K = lexer::TokenKind;
+            expect(tokens.size() == 4_i);
+            expect(tokens[0].kind == K::indent && tokens[1].kind == K::indent);
+            expect(tokens[2].kind == K::dedent && tokens[3].kind == K::dedent);
+
+            // an indent covers the leading spaces of the first line with code, comments only lines don't count
+            auto &lines = t1.lines();
+            auto indent = lines.resolve(tokens[0].span.begin);
+            expect(indent.line == 5_i && indent.column == 1_i);
+            expect(_ul(tokens[0].span.size()) == 4_ul);
+            expect(_ul(tokens[1].span.size()) == 8_ul);
+
+            // dedents are empty and sit at the code they go back to
+            auto first = lines.resolve(tokens[2].span.begin);
+            auto second = lines.resolve(tokens[3].span.begin);
+            expect(first.line == 10_i && first.column == 5_i);
+            expect(second.line == 11_i && second.column == 1_i);
+
+            expect(t1.docComments().size() == 1_i);
+        };
+
+        it("should skip blank lines and close open levels at the end") = [&] {
+            std::string_view program = "a :: 1\n\n\n    b :: 2\n   \n        c :: 3\n\n";
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto tokens = layout(t1.tokenize());
+
+            expect(tokens.size() == 4_i);
+            expect(tokens[2].kind == lexer::TokenKind::dedent && _ul(tokens[2].span.begin) == _ul(program.size()));
+            expect(tokens[3].kind == lexer::TokenKind::dedent && _ul(tokens[3].span.begin) == _ul(program.size()));
+
+            // only the line breaks after code are stepped
+            expect(std::count(t1._char_history.begin(), t1._char_history.end(), '\n') == 3_i);
+        };
+    };
+
+
+    describe("retokenize") = [] {
+
+        // Applies edit to program and checks retokenize against tokenizing the result from scratch
+        auto check = []<class T = lexer::grammar::MaraTokenizer>(std::string_view program, lexer::TextEdit edit,
+                                                                 std::type_identity<T> = {}) {
+            std::string edited{program};
+            edited.replace(edit.offset, edit.removed, edit.inserted);
+
+            auto t1 = T{program};
+            auto t2 = T{edited};
+
+            auto previous = t1.tokenize();
+            auto before = t1._char_history.size();
+            auto tokens = t1.retokenize(edited, previous, edit);
+            auto looked_at = t1._char_history.size() - before;
+
+            auto expected = t2.tokenize();
+            expect(tokens == expected);
+
+            auto &docs = t1.docComments();
+            auto &expected_docs = t2.docComments();
+            expect(_ul(docs.size()) == _ul(expected_docs.size()));
+            for (std::size_t i = 0; i < docs.size() && i < expected_docs.size(); ++i) {
+                expect(docs[i].span == expected_docs[i].span && docs[i].text == expected_docs[i].text);
+            }
+
+            auto &restarts = t1.restartPoints();
+            auto &expected_restarts = t2.restartPoints();
+            expect(_ul(restarts.size()) == _ul(expected_restarts.size()));
+            for (std::size_t i = 0; i < restarts.size() && i < expected_restarts.size(); ++i) {
+                expect(restarts[i].offset == expected_restarts[i].offset && restarts[i].tokens == expected_restarts[i].tokens);
+                expect(restarts[i].examined >= expected_restarts[i].examined);
+            }
+
+            return looked_at;
+        };
+
+        std::string program;
+        for (int i = 0; i < 50; ++i) {
+            program += "foo : int : (a: int)\n    -- doc\n    a = \"text\"!\n    return a, 42\n";
+        }
+        auto middle = static_cast<lexer::SourceOffset>(program.size() / 2);
+
+        it("should only tokenize the lines around an edit") = [&] {
+            auto looked_at = check(program, {middle, 0, "b :: 3"});
+            expect(looked_at < _ul(program.size() / 10));
+
+            expect(check(program, {middle, 4, ""}) < _ul(program.size() / 10));
+            expect(check(program, {0, 3, "bar"}) < _ul(program.size() / 10));
+        };
+
+        it("should follow an edit that opens a string or a block comment") = [&] {
+            auto opened = program.find("text");
+
+            // everything after an opened string changes until the next quote pairs up again
+            check(program, {static_cast<lexer::SourceOffset>(opened), 0, "\""});
+            check(program, {middle, 0, "!- "});
+            check(program, {middle, 0, "!- \n -!"});
+            check(program, {static_cast<lexer::SourceOffset>(program.size() - 1), 1, "\n-- end"});
+        };
+
+        it("should restart before a lexeme that looked past the edit") = [&] {
+            std::string unclosed = "a = \"x!\n";
+            for (int i = 0; i < 50; ++i) {
+                unclosed += "b = 1!\n";
+            }
+            auto closing = static_cast<lexer::SourceOffset>(unclosed.size() / 2);
+
+            // the lone quote looked to the end of the program for its pair, the quote closes the string
+            auto table = std::type_identity<lexer::grammar::MaraTableTokenizer>{};
+            check(unclosed, {closing, 0, "\""}, table);
+            check(unclosed, {closing, 0, "\"\n"}, table);
+            check(program, {static_cast<lexer::SourceOffset>(program.find("text")), 0, "\""}, table);
+
+            auto restarts = [](std::string_view program) {
+                auto tokenizer = lexer::grammar::MaraTableTokenizer{program};
+                tokenizer.tokenize();
+                return tokenizer.restartPoints();
+            };
+            expect(restarts(unclosed).back().examined == _ul(unclosed.size()));
+            expect(restarts(program).front().examined < _ul(program.size() / 2));
+        };
+
+        it("should update doc comments under an edited header") = [&] {
+            auto header = program.find(")\n", middle);
+
+            // the comment under the header stops being a doc comment
+            check(program, {static_cast<lexer::SourceOffset>(header), 1, ""});
+            check(program, {static_cast<lexer::SourceOffset>(header + 1), 0, "\n\n"});
+        };
+
+        it("should reject a stream from another program") = [&] {
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            t1.tokenize();
+
+            expect(throws<std::invalid_argument>([&] {
+                t1.retokenize(program, lexer::TokenStream{}, {middle, 0, ""});
+            }));
+        };
+    };
+
+
+    describe("parallel") = [] {
+
+        std::string program;
+        for (int i = 0; i < 40; ++i) {
+            program += "foo : int : (a: int)\n    -- doc\n    a = \"text\"!\n    return a, 42\n";
+            // chunks that start in a block comment or a string have to be tokenized again
+            program += i % 3 == 0 ? "!- a :: 1\nb :: 2\nc :: 3 -!\n" : "s :: \"one\ntwo\nthree\"\n";
+        }
+
+        ThreadPool pool(4);
+
+        it("should produce the same tokens as tokenizing at once") = [&] {
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto expected = t1.tokenize();
+
+            for (std::size_t chunk_size: {1, 7, 64, 1000, 1 << 20}) {
+                auto section = lexer::tokenizeParallel(t1, pool, chunk_size);
+
+                expect(section.begin == 0_i && _ul(section.end) == _ul(program.size()));
+                expect(section.tokens == expected);
+                expect(_ul(section.docs.size()) == _ul(t1.docComments().size()));
+
+                auto &restarts = t1.restartPoints();
+                expect(_ul(section.restarts.size()) == _ul(restarts.size()));
+                for (std::size_t i = 0; i < restarts.size() && i < section.restarts.size(); ++i) {
+                    expect(section.restarts[i].offset == restarts[i].offset);
+                    expect(section.restarts[i].tokens == restarts[i].tokens);
+                    expect(section.restarts[i].docs == restarts[i].docs);
+                }
+            }
+        };
+
+        it("should work with the table tokenizer") = [&] {
+            auto t1 = lexer::grammar::MaraTableTokenizer{program};
+            auto expected = t1.tokenize();
+
+            expect(lexer::tokenizeParallel(t1, pool, 100).tokens == expected);
+        };
+
+        it("should split only at lines that aren't indented") = [&] {
+            std::string_view program = "a\n  b\n\nc\n";
+
+            expect(_ul(lexer::chunkStart(program, 1)) == 7_ul);
+            expect(_ul(lexer::chunkStart(program, 8)) == _ul(program.size()));
+
+            auto empty = lexer::grammar::MaraTokenizer{""};
+            expect(lexer::tokenizeParallel(empty, pool).tokens.empty());
+        };
+    };
+
+
+    describe("stream") = [] {
+
+        std::string program;
+        for (int i = 0; i < 20; ++i) {
+            program += "foo : int : (a: int)\n    -- doc\n    a = \"text\"!\n    return a, 42\n";
+            program += i % 3 == 0 ? "!- a :: 1\nb :: 2\nc :: 3 -!\n" : "s :: \"one\ntwo\nthree\"\n";
+        }
+
+        // Feeds program to tokenizer chunk_size bytes at a time
+        auto stream = [&](lexer::Tokenizer &tokenizer, std::size_t chunk_size) {
+            lexer::TokenStream tokens;
+            for (std::size_t i = 0; i < program.size(); i += chunk_size) {
+                tokens.append(tokenizer.feed(std::string_view(program).substr(i, chunk_size)));
+            }
+            tokens.append(tokenizer.finish());
+            return tokens;
+        };
+
+        it("should produce the same tokens as tokenizing at once") = [&] {
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto expected = t1.tokenize();
+            auto expected_docs = t1.docComments();
+
+            for (std::size_t chunk_size: {1, 3, 7, 64, 1 << 20}) {
+                auto t2 = lexer::grammar::MaraTokenizer{""};
+                expect(stream(t2, chunk_size) == expected);
+
+                auto &docs = t2.docComments();
+                expect(_ul(docs.size()) == _ul(expected_docs.size()));
+                for (std::size_t i = 0; i < docs.size() && i < expected_docs.size(); ++i) {
+                    expect(docs[i].span == expected_docs[i].span && docs[i].text == expected_docs[i].text);
+                }
+            }
+        };
+
+        it("should work with the table, fsm and regex tokenizers") = [&] {
+            auto t1 = lexer::grammar::MaraTableTokenizer{program};
+            auto t2 = lexer::grammar::MaraTableTokenizer{""};
+            expect(stream(t2, 5) == t1.tokenize());
+
+            auto fsm = [](std::string_view program) {
+                auto tokenizer = lexer::FSMTokenizer{program};
+                tokenizer.add_fsm("string", R"("[^"]*")");
+                tokenizer.add_fsm("identifier", R"([a-zA-Z_]\w*)");
+                tokenizer.add_fsm("number", R"(\d+)");
+                return tokenizer;
+            };
+            auto t3 = fsm("");
+            auto t4 = fsm(program);
+            expect(stream(t3, 5) == t4.tokenize());
+
+            auto t5 = lexer::RegexTokenizer{""};
+            auto t6 = lexer::RegexTokenizer{program};
+            expect(stream(t5, 5) == t6.tokenize());
+        };
+
+        it("should lay out lines the same wherever the chunks split") = [] {
+            // pieces of indented code, the layout has to come out the same around every one of them
+            const std::string_view pieces[] = {"a", "b1", " ", "  ", "\t", "\n", "\n    ", "\n  ", "\n\n",
+                                               "\"", "\"s\n t\"", "-- c\n", "\n   -- d\n", "!- x -!",
+                                               "!- \n -!", "(", ")", ":", "=", "!", "42", "return "};
+
+            // Feeds program split at random places, cut in one of three bytes
+            auto split = [](std::string_view program, std::mt19937 &random) {
+                auto tokenizer = lexer::grammar::MaraTokenizer{""};
+                lexer::TokenStream tokens;
+                std::size_t last = 0;
+                for (std::size_t i = 1; i < program.size(); ++i) {
+                    if (random() % 3 == 0) {
+                        tokens.append(tokenizer.feed(program.substr(last, i - last)));
+                        last = i;
+                    }
+                }
+                tokens.append(tokenizer.feed(program.substr(last)));
+                tokens.append(tokenizer.finish());
+                return tokens;
+            };
+
+            std::mt19937 random(16);
+            std::vector<std::string> programs = {"\"\"\"\"\"\"\"\"\"\"\"\"\"\"t\"\"\nblexks5s !"};
+            for (int i = 0; i < 500; ++i) {
+                auto &program = programs.emplace_back();
+                for (auto n = random() % 60; n > 0; --n) {
+                    program += pieces[random() % std::size(pieces)];
+                }
+            }
+
+            for (auto &program: programs) {
+                auto expected = lexer::grammar::MaraTokenizer{program}.tokenize();
+                expect(split(program, random) == expected) << program;
+            }
+
+            // the dedent is where the code after the blank lines and comments starts
+            std::string_view program = "a\n    b = \"s\n  t\"\n\n  -- c\n!- d\n -! e";
+            auto tokens = split(program, random);
+            expect(tokens == lexer::grammar::MaraTokenizer{program}.tokenize());
+            auto dedent = std::find_if(tokens.begin(), tokens.end(),
+                                       [](auto token) { return token.kind == lexer::TokenKind::dedent; });
+            expect(dedent != tokens.end() && _ul((*dedent).span.begin) == _ul(program.find("!-")));
+        };
+
+        it("should only keep the text of the open token") = [&] {
+            auto tokenizer = lexer::grammar::MaraTokenizer{program};
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < program.size(); i += 4) {
+                tokenizer.feed(std::string_view(program).substr(i, 4));
+                kept = std::max(kept, tokenizer.program().size());
+            }
+            tokenizer.finish();
+
+            // the block comments are the longest, the rest is a chunk and a few bytes around it
+            expect(_ul(kept) < 64_ul);
+            expect(tokenizer.program() == program);
+        };
+    };
+
+
+    describe("table tokenizer") = [] {
+
+        using Table = lexer::grammar::MaraTableTokenizer;
+
+        static_assert(Table::table.states() > 2, "the table is built at compile time");
+
+        it("should build the same table at runtime") = [] {
+            std::vector<std::string_view> patterns;
+            for (auto &token: lexer::grammar::MaraPatterns::tokens) {
+                patterns.push_back(token.pattern);
+            }
+
+            auto dfa = lexer::dfa::compile(patterns);
+
+            expect(_ul(dfa.states()) == _ul(Table::table.states()));
+            expect(std::equal(dfa.next.begin(), dfa.next.end(), Table::table.next.begin()));
+            expect(std::equal(dfa.accept.begin(), dfa.accept.end(), Table::table.accept.begin()));
+        };
+
+        it("should prefer the longest match and then the earliest pattern") = [] {
+            auto view = Table::table.view();
+
+            // "as" is listed before identifiers
+            auto m1 = lexer::dfa::munch(view, "as x", 0);
+            expect(m1.length == 2_i);
+            expect(lexer::grammar::MaraPatterns::tokens[m1.pattern].kind == lexer::TokenKind::decl_keyword);
+
+            auto m2 = lexer::dfa::munch(view, "ask", 0);
+            expect(m2.length == 3_i);
+            expect(lexer::grammar::MaraPatterns::tokens[m2.pattern].kind == lexer::TokenKind::identifier);
+
+            auto m3 = lexer::dfa::munch(view, "3.14!", 0);
+            expect(m3.length == 4_i);
+
+            // a block comment that never ends is just a bang
+            auto m4 = lexer::dfa::munch(view, "!- not closed", 0);
+            expect(m4.length == 1_i);
+        };
+
+        it("should tokenize and skip comments") = [] {
+            std::string_view program = "a :: 2\n-- comment\nb as \"x y\"!- doc\n-- -!\nc = 3!";
+
+            auto t1 = Table{program};
+            auto tokens = t1.tokenize();
+
+            using K = lexer::TokenKind;
+            auto expected = std::vector{
+                    K::identifier, K::decl_keyword, K::number, K::identifier, K::decl_keyword, K::string,
+                    K::identifier, K::assign, K::number, K::bang
+            };
+
+            expect(_ul(tokens.size()) == _ul(expected.size()));
+            for (std::size_t i = 0; i < tokens.size() && i < expected.size(); ++i) {
+                expect(tokens[i].kind == expected[i]);
+            }
+
+            expect(test::eq(t1.lines().resolve(tokens[0].span).toString(), std::string("(1:1)-(1:1)")));
+            expect(test::eq(t1.lines().resolve(tokens[3].span).toString(), std::string("(3:1)-(3:1)")));
+            expect(test::eq(t1.lines().resolve(tokens[6].span).toString(), std::string("(5:1)-(5:1)")));
+        };
+    };
+
+    describe("fsm tokenizer") = [] {
+
+        it("should match every token type in one pass") = [] {
+            std::string_view program = "count :: 12\nname = \"x\"!";
+
+            auto t1 = lexer::FSMTokenizer{program};
+            t1.add_fsm("whitespace", R"([ \n]+)");
+            t1.add_fsm("decl_keyword", "::|as");
+            t1.add_fsm("identifier", R"([a-z_]\w*)");
+            t1.add_fsm("number", R"(\d+)");
+            t1.add_fsm("string", R"("[^"]*")");
+            t1.add_fsm("assign", "=");
+            t1.add_fsm("bang", "!");
+
+            auto tokens = t1.tokenize();
+
+            using K = lexer::TokenKind;
+            auto expected = std::vector{
+                    K::identifier, K::decl_keyword, K::number, K::identifier, K::assign, K::string, K::bang
+            };
+
+            expect(_ul(tokens.size()) == _ul(expected.size()));
+            for (std::size_t i = 0; i < tokens.size() && i < expected.size(); ++i) {
+                expect(tokens[i].kind == expected[i]);
+            }
+
+            expect(test::eq(t1.lines().resolve(tokens[3].span).toString(), std::string("(2:1)-(2:4)")));
+        };
+
+        it("should prefer the longest match and then the first fsm") = [] {
+            auto t1 = lexer::FSMTokenizer{""};
+            t1.add_fsm("decl_keyword", "as");
+            t1.add_fsm("identifier", R"([a-z]+)");
+
+            auto [l1, n1] = t1.match_fsm("as x");
+            expect(l1 == 2_ul);
+            expect(n1 == std::string_view("decl_keyword"));
+
+            auto [l2, n2] = t1.match_fsm("ask");
+            expect(l2 == 3_ul);
+            expect(n2 == std::string_view("identifier"));
+
+            // adding a token type again replaces its pattern
+            t1.add_fsm("decl_keyword", "::");
+            auto [l3, n3] = t1.match_fsm("as");
+            expect(n3 == std::string_view("identifier"));
+
+            auto [l4, n4] = t1.match_fsm("?");
+            expect(l4 == 0_ul);
+        };
+
+        it("should reject malformed patterns") = [] {
+            auto t1 = lexer::FSMTokenizer{""};
+            expect(throws<std::invalid_argument>([&] { t1.add_fsm("number", R"((\d+)"); }));
+        };
+    };
+
+    describe("regex tokenizer") = [] {
+
+        it("should match whole lexemes") = [] {
+            std::string_view program = "count :: 12.5\nreturn (a, b)? ask";
+
+            auto t1 = lexer::RegexTokenizer{program};
+            auto tokens = t1.tokenize();
+
+            using K = lexer::TokenKind;
+            auto expected = std::vector{
+                    K::identifier, K::decl_keyword, K::number, K::return_keyword, K::paren_open, K::identifier,
+                    K::comma, K::identifier, K::paren_close, K::question, K::identifier
+            };
+
+            expect(_ul(tokens.size()) == _ul(expected.size()));
+            for (std::size_t i = 0; i < tokens.size() && i < expected.size(); ++i) {
+                expect(tokens[i].kind == expected[i]);
+            }
+
+            expect(tokens[2].span == lexer::SourceSpan{9, 13});
+            expect(tokens[10].span == lexer::SourceSpan{29, 32});
+        };
+
+        it("should report the pattern that matched") = [] {
+            using Pattern = lexer::RegexTokenizer::Pattern;
+
+            auto [l1, p1] = lexer::RegexTokenizer::match("as x");
+            expect(l1 == 2_ul);
+            expect(p1 == Pattern::keyword);
+
+            auto [l2, p2] = lexer::RegexTokenizer::match("asx");
+            expect(l2 == 3_ul);
+            expect(p2 == Pattern::identifier);
+
+            auto [l3, p3] = lexer::RegexTokenizer::match("1.25.");
+            expect(l3 == 4_ul);
+            expect(p3 == Pattern::number);
+
+            auto [l4, p4] = lexer::RegexTokenizer::match(" \n\tx");
+            expect(l4 == 3_ul);
+            expect(p4 == Pattern::whitespace);
+
+            auto [l5, p5] = lexer::RegexTokenizer::match("$");
+            expect(l5 == 0_ul);
+            expect(p5 == Pattern::none);
+        };
+    };
+
+    describe("interner") = [] {
+
+        it("should give each distinct text one id") = [] {
+            auto names = lexer::Interner();
+
+            auto a = names.intern("alpha");
+            auto b = names.intern("beta");
+
+            expect(a != lexer::no_name);
+            expect(a != b);
+            expect(names.intern(std::string("alpha")) == a);
+            expect(names.find("beta") == b);
+            expect(names.find("gamma") == lexer::no_name);
+            expect(names.text(a) == std::string_view("alpha"));
+            expect(names.size() == 2_ul);
+
+            // longer than an arena block
+            auto long_text = std::string(100000, 'x');
+            auto c = names.intern(long_text);
+            expect(names.text(c) == long_text);
+            expect(names.text(a) == std::string_view("alpha"));
+        };
+
+        it("should name the identifiers of a token stream") = [] {
+            std::string_view program = "a :: b\nc = a!\nb = c!";
+
+            auto names = lexer::Interner();
+            auto tokens = lexer::grammar::MaraTableTokenizer{program}.tokenize();
+            names.intern(program, tokens);
+
+            for (auto token: tokens) {
+                if (token.kind == lexer::TokenKind::identifier) {
+                    auto text = program.substr(token.span.begin, token.span.size());
+                    expect(names.text(token.name) == text);
+                } else {
+                    expect(token.name == lexer::no_name);
+                }
+            }
+
+            expect(names.size() == 3_ul);
+            expect(tokens[0].name == names.find("a"));
+
+            // the rule tokenizer gives its identifiers the same spans
+            auto rule_tokens = lexer::grammar::MaraTokenizer{program}.tokenize();
+            names.intern(program, rule_tokens);
+            expect(rule_tokens[0].name == names.find("a"));
+            expect(names.size() == 3_ul);
+        };
+
+        it("should give the same ids from many threads") = [] {
+            auto names = lexer::Interner::concurrent(4);
+            expect(names.isConcurrent());
+
+            ThreadPool pool(4);
+            std::vector<std::future<std::vector<lexer::NameId>>> tasks;
+            for (int t = 0; t < 4; ++t) {
+                tasks.push_back(pool.submit([&names, t] {
+                    std::vector<lexer::NameId> ids;
+                    for (int i = 0; i < 1000; ++i) {
+                        ids.push_back(names.intern("name_" + std::to_string((i * 7 + t * 13) % 1000)));
+                    }
+                    return ids;
+                }));
+            }
+
+            for (auto &task: tasks) {
+                task.wait();
+            }
+            for (int t = 0; t < 4; ++t) {
+                auto ids = tasks[t].get();
+                for (int i = 0; i < 1000; ++i) {
+                    auto text = "name_" + std::to_string((i * 7 + t * 13) % 1000);
+                    expect(names.find(text) == ids[i]);
+                    expect(names.text(ids[i]) == text);
+                }
+            }
+
+            expect(names.size() == 1000_ul);
+        };
+
+        it("should name the tokens of tokenizeParallel") = [] {
+            std::string program;
+            for (int i = 0; i < 5000; ++i) {
+                program += "value_" + std::to_string(i % 300) + " :: other_" + std::to_string(i % 7) + "\n";
+            }
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            ThreadPool pool(4);
+            auto section = lexer::tokenizeParallel(t1, pool, 4096);
+
+            auto names = lexer::Interner::concurrent();
+            names.intern(program, section.tokens, pool);
+
+            auto serial = lexer::Interner();
+            auto tokens = lexer::grammar::MaraTokenizer{program}.tokenize();
+            serial.intern(program, tokens);
+
+            expect(names.size() == serial.size());
+            expect(_ul(section.tokens.size()) == _ul(tokens.size()));
+            for (std::size_t i = 0; i < tokens.size() && i < section.tokens.size(); ++i) {
+                auto name = section.tokens[i].name;
+                expect((name == lexer::no_name) == (tokens[i].name == lexer::no_name));
+                if (name != lexer::no_name) {
+                    expect(names.text(name) == serial.text(tokens[i].name));
+                }
+            }
+        };
+    };
+
+    describe("numbers") = [] {
+        using lexer::Number;
+
+        it("should decode integers") = [] {
+            expect(lexer::decodeNumber("0").integer == 0);
+            expect(lexer::decodeNumber("42").integer == 42);
+            expect(lexer::decodeNumber("00012345678").integer == 12345678);
+            expect(lexer::decodeNumber("1234567890123456789").integer == 1234567890123456789);
+            expect(lexer::decodeNumber("9223372036854775807").integer == INT64_MAX);
+            expect(lexer::decodeNumber("12 ").integer == 12);
+            expect(lexer::decodeNumber("7").type == Number::Type::integer);
+
+            auto overflow = lexer::decodeNumber("9223372036854775808");
+            expect(overflow.overflow);
+            expect(overflow.integer == INT64_MAX);
+            expect(lexer::decodeNumber("123456789012345678901234").overflow);
+            expect(!lexer::decodeNumber("000000000000000000000001").overflow);
+        };
+
+        it("should round reals like strtod") = [] {
+            expect(lexer::decodeNumber("12.5").real == 12.5);
+            expect(lexer::decodeNumber("0.1").real == 0.1);
+            expect(lexer::decodeNumber("0.1").type == Number::Type::real);
+            expect(lexer::decodeNumber("3.14159265358979323846264338").real == 3.14159265358979323846264338);
+            expect(lexer::decodeNumber("1.0 ").real == 1.0);
+
+            std::uint64_t state = 42;
+            for (int i = 0; i < 20000; ++i) {
+                state = state * 6364136223846793005ull + 1442695040888963407ull;
+                auto text = std::to_string(state >> (state % 64)) + "." +
+                            std::to_string(state % 1000003) + std::string(i % 5, '0') + std::to_string(state >> 50);
+                expect(lexer::decodeNumber(text).real == std::strtod(text.c_str(), nullptr)) << text;
+            }
+        };
+
+        it("should give number tokens their values") = [] {
+            std::string_view program = "x = 12.5\ny = 300";
+            auto t1 = lexer::RegexTokenizer{program};
+            auto tokens = t1.tokenize();
+
+            std::vector<Number> values;
+            for (std::size_t i = 0; i < tokens.size(); ++i) {
+                expect((tokens[i].kind == lexer::TokenKind::number) == tokens.number(i).has_value());
+                if (auto number = tokens.number(i)) {
+                    values.push_back(*number);
+                }
+            }
+
+            expect(_ul(values.size()) == 2_ul);
+            expect(values[0].type == Number::Type::real && values[0].real == 12.5);
+            expect(values[1].type == Number::Type::integer && values[1].integer == 300);
+            expect(t1.diagnostics().empty());
+
+            auto table = lexer::grammar::MaraTableTokenizer{"a = 7\nb = 1234567890123\n"}.tokenize();
+            expect(_ul(table.numbers().size()) == 2_ul);
+            expect(table.numbers()[1].integer == 1234567890123);
+        };
+
+        it("should report literals that overflow") = [] {
+            std::string_view program = "a = 1\nb = 99999999999999999999\n";
+            auto t1 = lexer::grammar::MaraTableTokenizer{program};
+            auto tokens = t1.tokenize();
+
+            expect(_ul(t1.diagnostics().size()) == 1_ul);
+            auto &diagnostic = t1.diagnostics()[0];
+            expect(diagnostic.error == lexer::LexErrorCode::number_overflow);
+            expect(program.substr(diagnostic.span.begin, diagnostic.span.size()) == "99999999999999999999");
+            expect(tokens.numbers()[1].overflow);
+        };
+
+        it("should keep values and diagnostics through retokenize and tokenizeParallel") = [] {
+            std::string program;
+            for (int i = 0; i < 2000; ++i) {
+                program += "value_" + std::to_string(i) + " = " + std::to_string(i * 37) +
+                           (i % 500 == 0 ? "999999999999999999999" : "") + "\n";
+            }
+
+            auto t1 = lexer::grammar::MaraTableTokenizer{program};
+            auto expected = t1.tokenize();
+            auto expected_diagnostics = t1.diagnostics();
+            expect(_ul(expected_diagnostics.size()) == 4_ul);
+
+            ThreadPool pool(4);
+            auto section = lexer::tokenizeParallel(t1, pool, 4096);
+            expect(section.tokens == expected);
+            expect(_ul(section.diagnostics.size()) == 4_ul);
+            for (std::size_t i = 0; i < section.diagnostics.size() && i < 4; ++i) {
+                expect(section.diagnostics[i].span == expected_diagnostics[i].span);
+            }
+
+            // a longer literal at the start shifts everything after it
+            auto t2 = lexer::grammar::MaraTokenizer{program};
+            auto previous = t2.tokenize();
+            auto edit = lexer::TextEdit{static_cast<lexer::SourceOffset>(program.find(" = 0") + 3), 1, "123"};
+            std::string edited{program};
+            edited.replace(edit.offset, edit.removed, edit.inserted);
+
+            auto tokens = t2.retokenize(edited, previous, edit);
+            auto t3 = lexer::grammar::MaraTokenizer{edited};
+            expect(tokens == t3.tokenize());
+            expect(_ul(t2.diagnostics().size()) == _ul(t3.diagnostics().size()));
+            for (std::size_t i = 0; i < t2.diagnostics().size() && i < t3.diagnostics().size(); ++i) {
+                expect(t2.diagnostics()[i].span == t3.diagnostics()[i].span);
+            }
+        };
+    };
+
+    describe("string literals") = [] {
+
+        it("should decode escapes only when there are some") = [] {
+            lexer::Arena arena;
+
+            std::string_view plain = "no escapes here";
+            auto value = lexer::unescape(plain, arena);
+            expect(value == plain);
+            expect(value.data() == plain.data());
+
+            expect(lexer::unescape(R"(a\tb\nc\\d\"e\0f)", arena) == std::string_view("a\tb\nc\\d\"e\0f", 11));
+            expect(lexer::unescape(R"(\q stays\)", arena) == std::string_view(R"(\q stays\)"));
+
+            std::string out = "> ";
+            lexer::unescape(R"(one\ttwo)", out);
+            expect(out == "> one\ttwo");
+
+            expect(lexer::stringBody("\"text\"") == "text");
+            expect(lexer::stringBody("\"open") == "open");
+            expect(lexer::stringBody("\"") == "");
+        };
+
+        it("should mark string tokens with backslashes while lexing") = [] {
+            std::string_view program = "a = \"tab\\there\"!\nb = \"plain\"!\n";
+
+            lexer::Arena arena;
+            auto check = [&](const lexer::TokenStream &tokens) {
+                std::vector<std::size_t> strings;
+                for (std::size_t i = 0; i < tokens.size(); ++i) {
+                    if (tokens.kind(i) == lexer::TokenKind::string) {
+                        strings.push_back(i);
+                    }
+                }
+
+                expect(_ul(strings.size()) == 2_ul);
+                if (strings.size() != 2) {
+                    return;
+                }
+
+                expect(tokens[strings[0]].span.text(program) == "\"tab\\there\"");
+                expect(tokens.escaped(strings[0]));
+                expect(lexer::stringValue(tokens, strings[0], program, arena) == "tab\there");
+
+                // the value of a literal without escapes is its text in the program
+                expect(!tokens.escaped(strings[1]));
+                auto plain = lexer::stringValue(tokens, strings[1], program, arena);
+                expect(plain == "plain");
+                expect(plain.data() == program.data() + program.find("plain"));
+            };
+
+            check(lexer::grammar::MaraTokenizer{program}.tokenize());
+            check(lexer::grammar::MaraTableTokenizer{program}.tokenize());
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto previous = t1.tokenize();
+            auto edit = lexer::TextEdit{static_cast<lexer::SourceOffset>(program.find("b =")), 1, "bb"};
+            std::string edited{program};
+            edited.replace(edit.offset, edit.removed, edit.inserted);
+            auto tokens = t1.retokenize(edited, previous, edit);
+            expect(tokens == lexer::grammar::MaraTokenizer{edited}.tokenize());
+            expect(tokens.escaped(2));
+        };
+
+        it("should keep a long string in one token") = [] {
+            std::string program = "a = \"" + std::string(100000, 'x') + "\"!\n";
+
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto tokens = t1.tokenize();
+
+            expect(_ul(t1._char_history.size()) == _ul(program.size()));
+            expect(tokens.size() == 4_i);
+            expect(tokens[2].span.size() == 100002_ul);
+        };
+    };
+
+    describe("keywords") = [] {
+
+        static_assert(lexer::grammar::keywordKind("mutable") == lexer::TokenKind::mutable_keyword);
+
+        it("should classify keywords and operators") = [] {
+            using lexer::TokenKind;
+            using lexer::grammar::keywordKind;
+
+            expect(keywordKind("as") == TokenKind::decl_keyword);
+            expect(keywordKind("::") == TokenKind::decl_keyword);
+            expect(keywordKind("return") == TokenKind::return_keyword);
+            expect(keywordKind("(") == TokenKind::paren_open);
+            expect(keywordKind(",") == TokenKind::comma);
+        };
+
+        it("should not classify other words") = [] {
+            using lexer::TokenKind;
+            using lexer::grammar::keywordKind;
+
+            for (auto text: {"", "a", "asx", "returns", "retur", ":::", "mutable_", "a_rather_long_identifier_name"}) {
+                expect(keywordKind(text) == TokenKind::none) << text;
+            }
+
+            // the same bytes as a keyword in a longer view
+            std::string_view program = "return";
+            expect(keywordKind(program.substr(0, 3)) == TokenKind::none);
+        };
+
+        it("should create tokens from names") = [] {
+            auto span = lexer::SourceSpan{0, 6};
+
+            auto token = lexer::TokenFactory::create_token("return", "token", "declaration", span);
+            expect(token.kind == lexer::TokenKind::return_keyword);
+            expect(token.symbol == lexer::Symbol::return_keyword);
+            expect(token.identifier_type == lexer::IdentifierType::token);
+            expect(token.expression_type == lexer::ExpressionType::declaration);
+
+            auto other = lexer::TokenFactory::create_token("name", "identifier", "", span);
+            expect(other.kind == lexer::TokenKind::none);
+            expect(other.symbol == lexer::Symbol::none);
+            expect(other.identifier_type == lexer::IdentifierType::identifier);
+            expect(other.expression_type == lexer::ExpressionType::none);
+        };
+    };
+
+    describe("scan") = [] {
+
+        it("should classify bytes without the locale") = [] {
+            using namespace lexer::scan;
+
+            expect(isWord('_') && isWord('z') && isWord('Z') && isWord('0'));
+            expect(!isWord('-') && !isWord('\xe9'));
+            expect(isDigit('7') && !isDigit('a'));
+            expect(isSpace('\n') && isSpace('\t') && !isSpace('_'));
+        };
+
+        it("should measure runs longer than a vector") = [] {
+            using namespace lexer::scan;
+
+            std::string word(100, 'w');
+            word[70] = 'Q';
+            word[71] = '_';
+            word[90] = '-';
+            expect(_ul(wordRun(word)) == 90_ul);
+            expect(_ul(wordRun(std::string_view(word).substr(91))) == 9_ul);
+
+            std::string digits = std::string(40, '7') + "x" + std::string(3, '1');
+            expect(_ul(digitRun(digits)) == 40_ul);
+
+            std::string spaces = std::string(33, ' ') + "\t\n\r" + "\xa0";
+            expect(_ul(spaceRun(spaces)) == 36_ul);
+
+            expect(_ul(wordRun("")) == 0_ul);
+            expect(_ul(wordRun("\x80abc")) == 0_ul);
+        };
+
+        it("should stop padded scans on the padding") = [] {
+            using namespace lexer::scan;
+
+            for (std::size_t size: {0, 1, 7, 8, 31, 32, 33, 64, 100}) {
+                auto padded = lexer::PaddedString(std::string(size, 'w'));
+                expect(_ul(paddedRun(CharClass::word, padded.view().data())) == _ul(size));
+                expect(_ul(findPair(padded.view(), 'w', '!')) == _ul(size));
+
+                auto closed = lexer::PaddedString(std::string(size, ' ') + "-!");
+                expect(_ul(findPair(closed.view(), '-', '!')) == _ul(size));
+                expect(_ul(findPair(closed.view(), '-', '!', size + 1)) == _ul(size + 2));
+            }
+
+            auto padded = lexer::PaddedString(std::string_view("ab"));
+            for (std::size_t i = 0; i < lexer::padding; ++i) {
+                expect(padded.view().data()[2 + i] == '\0');
+            }
+        };
+
+        it("should give the same tokens for padded programs") = [] {
+            std::string program;
+            for (int i = 0; i < 20; ++i) {
+                program += "identifier_" + std::string(i * 3, 'x') + " :: 1234567890 !- comment -!\n";
+            }
+
+            auto padded = lexer::PaddedString(std::string_view(program));
+            auto t1 = lexer::grammar::MaraTokenizer{program};
+            auto t2 = lexer::grammar::MaraTokenizer{padded.view()};
+
+            expect(t1.tokenize() == t2.tokenize());
+        };
+    };
 };
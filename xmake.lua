@@ -7,6 +7,9 @@ set_languages("cxx2a")
 set_defaultmode("debug")
 set_toolchains("clang-cl")
 
+-- the compile time DFA of the table tokenizer needs more than clang's default step limit
+add_cxxflags("/clang:-fconstexpr-steps=16777216", { tools = "clang_cl" })
+
 add_requires("vcpkg::spdlog", { alias = "spdlog" })
 add_requires("vcpkg::fmt", { alias = "fmt" })
 add_requires("vcpkg::tl-expected", { alias = "tl-expected" })
@@ -58,4 +61,15 @@ set_rundir("$(projectdir)")
 p()
 -- test packages
 add_packages("bext-ut")
-target_end()
\ No newline at end of file
+target_end()
+target("rara-bench")
+set_arch("x64")
+set_kind("binary")
+add_includedirs("include", { public = true })
+f()
+add_files("bench/*.cpp")
+set_rundir("$(projectdir)")
+-- timings of a debug build don't mean much
+set_optimize("faster")
+p()
+target_end()